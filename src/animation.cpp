@@ -0,0 +1,80 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "animation.h"
+
+#include "reactor.h"
+
+#include <cstdint>
+
+Uint32 AnimationScheduler::currentFrame = 0;
+Uint32 AnimationScheduler::nextFrame = 0;
+bool AnimationScheduler::paced = false;
+
+void AnimationScheduler::beginFrame()
+{
+	currentFrame = SDL_GetTicks();
+	if (!paced) {
+		// After being idle, don't try to catch up with the old schedule.
+		nextFrame = currentFrame + FRAME_INTERVAL;
+	}
+	paced = false;
+}
+
+void AnimationScheduler::waitForNextFrame()
+{
+	paced = true;
+
+	const Uint32 now = SDL_GetTicks();
+	const int32_t remaining = (int32_t) (nextFrame - now);
+	if (remaining > 0) {
+		// Input cuts the wait short, so that it is handled right away.
+		Reactor::instance().waitForEvent(remaining);
+		nextFrame += FRAME_INTERVAL;
+	} else {
+		// Late: drop the frames we missed and keep to the same rhythm.
+		nextFrame += FRAME_INTERVAL * (-remaining / FRAME_INTERVAL + 1);
+	}
+}
+
+Animation::Animation()
+	: from(0)
+	, to(0)
+	, startTime(0)
+	, duration(0)
+	, curve(Curve::LINEAR)
+{
+}
+
+void Animation::start(int from, int to, Uint32 duration, Curve curve)
+{
+	this->from = from;
+	this->to = to;
+	this->duration = duration;
+	this->curve = curve;
+	// Not the frame time: the last frame may have been drawn long ago.
+	startTime = SDL_GetTicks();
+}
+
+Uint32 Animation::elapsed() const
+{
+	const int32_t elapsed =
+			(int32_t) (AnimationScheduler::frameTime() - startTime);
+	return elapsed < 0 ? 0 : elapsed;
+}
+
+int Animation::currentValue() const
+{
+	const Uint32 t = elapsed();
+	if (t >= duration) {
+		return to;
+	}
+
+	// Progress as a 16.16 fixed point fraction.
+	int64_t progress = ((int64_t) t << 16) / duration;
+	if (curve == Curve::EASE_OUT) {
+		const int64_t left = (1 << 16) - progress;
+		progress = (1 << 16) - ((left * left) >> 16);
+	}
+	return from + (int) (((int64_t) (to - from) * progress) >> 16);
+}
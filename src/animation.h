@@ -0,0 +1,65 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __ANIMATION_H__
+#define __ANIMATION_H__
+
+#include <SDL.h>
+
+/**
+ * Paces the frames of the main loop while something is animating.
+ * Animations are computed from the time at which the current frame started,
+ * so their speed doesn't depend on how fast frames are rendered: if a frame
+ * takes too long, the frames that should have come meanwhile are skipped.
+ */
+class AnimationScheduler {
+public:
+	/** About 60 frames per second. */
+	static const Uint32 FRAME_INTERVAL = 16;
+
+	/** Called at the start of each frame, before animations run. */
+	static void beginFrame();
+
+	/** Time at which the current frame started, in SDL ticks. */
+	static Uint32 frameTime() { return currentFrame; }
+
+	/**
+	 * Sleeps until the next frame is due or an event arrives, or returns
+	 * right away if rendering is late.
+	 */
+	static void waitForNextFrame();
+
+private:
+	static Uint32 currentFrame, nextFrame;
+	static bool paced;
+};
+
+/**
+ * A value moving from one end to another in a given time.
+ */
+class Animation {
+public:
+	enum class Curve {
+		LINEAR,
+		/** Starts fast and slows down near the end. */
+		EASE_OUT,
+	};
+
+	Animation();
+
+	/** Starts moving from 'from' to 'to' in 'duration' milliseconds. */
+	void start(int from, int to, Uint32 duration, Curve curve = Curve::LINEAR);
+
+	bool isRunning() const { return elapsed() < duration; }
+	/** The value for the current frame. */
+	int currentValue() const;
+
+private:
+	Uint32 elapsed() const;
+
+	int from, to;
+	Uint32 startTime, duration;
+	Curve curve;
+};
+
+#endif // __ANIMATION_H__
@@ -21,6 +21,7 @@ public:
 	// Layer implementation:
 	virtual void paint(Surface& s);
 	virtual bool handleButtonPress(InputManager::Button button);
+	virtual const char *getName() { return "background"; }
 
 private:
 	GMenu2X& gmenu2x;
@@ -89,7 +89,12 @@ unsigned short Battery::getBatteryLevel()
 	return (voltage_now - voltage_min) * 6 / (voltage_max - voltage_min);
 }
 
-Battery::Battery(GMenu2X& gmenu2x) : sc(gmenu2x.sc)
+/** How often the battery status is checked, in milliseconds. */
+#define BATTERY_UPDATE_INTERVAL 60000
+
+Battery::Battery(GMenu2X& gmenu2x)
+	: sc(gmenu2x.sc)
+	, updateTimer(std::bind(&Battery::timerExpired, this))
 {
 	std::vector<std::string> bat_paths;
 	std::vector<std::string> pw_paths;
@@ -115,22 +120,25 @@ Battery::Battery(GMenu2X& gmenu2x) : sc(gmenu2x.sc)
 		}
 	}
 
-	lastUpdate = SDL_GetTicks();
 	update();
+	updateTimer.start(BATTERY_UPDATE_INTERVAL, BATTERY_UPDATE_INTERVAL);
 }
 
 const OffscreenSurface *Battery::getIcon()
 {
-	// Check battery status every 60 seconds.
-	unsigned int now = SDL_GetTicks();
-	if (now - lastUpdate >= 60000) {
-		lastUpdate = now;
-		update();
-	}
-
 	return sc.skinRes(iconPath);
 }
 
+void Battery::timerExpired()
+{
+	// Only wake up the menu if there is something new to show.
+	const std::string oldIconPath = iconPath;
+	update();
+	if (iconPath != oldIconPath) {
+		request_repaint();
+	}
+}
+
 void Battery::update()
 {
 	unsigned short battlevel = getBatteryLevel();
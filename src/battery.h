@@ -1,6 +1,8 @@
 #ifndef __BATTERY_H__
 #define __BATTERY_H__
 
+#include "reactor.h"
+
 #include <string>
 
 class GMenu2X;
@@ -22,11 +24,12 @@ public:
 
 private:
 	void update();
+	void timerExpired();
 	unsigned short getBatteryLevel();
 
 	SurfaceCollection& sc;
 	std::string iconPath;
-	unsigned int lastUpdate;
+	Reactor::Timer updateTimer;
 
 	std::string batterySysfs;
 	std::string powerSupplySysfs;
@@ -33,4 +33,5 @@ void BrightnessManager::setBrightness(unsigned int brightness)
 	std::ofstream brightness_f(sysfs_dir + "/" + "brightness");
 
 	brightness_f << std::to_string(brightness) << std::endl;
+	current_brightness = brightness;
 }
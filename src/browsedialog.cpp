@@ -5,6 +5,7 @@
 #include "filelister.h"
 #include "gmenu2x.h"
 #include "iconbutton.h"
+#include "latency.h"
 #include "surface.h"
 #include "utilities.h"
 
@@ -52,6 +53,7 @@ BrowseDialog::~BrowseDialog()
 
 bool BrowseDialog::exec()
 {
+	InputLatency::Context latency("browse dialog");
 	string path = getPath();
 	if (path.empty() || !fileExists(path)
 		|| path.compare(0, sizeof(GMENU2X_CARD_ROOT), GMENU2X_CARD_ROOT) != 0)
@@ -67,6 +69,7 @@ bool BrowseDialog::exec()
 		static_cast<Uint16>(gmenu2x.width() - 9),
 		static_cast<Uint16>(gmenu2x.height() - topBarHeight - 25)
 	};
+	rows.reset(new RowCache(*gmenu2x.font, clipRect.w, rowHeight, numRows));
 
 	selected = 0;
 	close = false;
@@ -105,7 +108,8 @@ BrowseDialog::Action BrowseDialog::getAction(InputManager::Button button)
 
 void BrowseDialog::handleInput()
 {
-	InputManager::Button button = gmenu2x.input.waitForPressedButton();
+	unsigned int steps;
+	InputManager::Button button = gmenu2x.input.waitForPressedButton(&steps);
 	BrowseDialog::Action action = getAction(button);
 
 	if (action == BrowseDialog::ACT_SELECT && fl[selected] == "..") {
@@ -116,28 +120,32 @@ void BrowseDialog::handleInput()
 		quit();
 		break;
 	case BrowseDialog::ACT_UP:
-		if (selected == 0)
-			selected = fl.size() - 1;
-		else
-			selected -= 1;
+		for (unsigned int i = 0; i < steps; i++) {
+			if (selected == 0)
+				selected = fl.size() - 1;
+			else
+				selected -= 1;
+		}
 		break;
 	case BrowseDialog::ACT_SCROLLUP:
-		if (selected <= numRows - 2)
+		if (selected <= steps * (numRows - 2))
 			selected = 0;
 		else
-			selected -= numRows - 2;
+			selected -= steps * (numRows - 2);
 		break;
 	case BrowseDialog::ACT_DOWN:
-		if (fl.size() - 1 <= selected)
-			selected = 0;
-		else
-			selected += 1;
+		for (unsigned int i = 0; i < steps; i++) {
+			if (fl.size() - 1 <= selected)
+				selected = 0;
+			else
+				selected += 1;
+		}
 		break;
 	case BrowseDialog::ACT_SCROLLDOWN:
-		if (selected+(numRows-2)>=fl.size())
+		if (selected + steps * (numRows - 2) >= fl.size())
 			selected = fl.size()-1;
 		else
-			selected += numRows-2;
+			selected += steps * (numRows - 2);
 		break;
 	case BrowseDialog::ACT_GOUP:
 		directoryUp();
@@ -211,14 +219,12 @@ void BrowseDialog::paint()
 	unsigned int firstElement, lastElement;
 	unsigned int offsetY;
 
-	OffscreenSurface bg(*gmenu2x.bg);
-	drawTitleIcon(bg, "icons/explorer.png", true);
-	writeTitle(bg, title);
-	writeSubTitle(bg, subtitle);
-	buttonBox.paint(bg, 5, gmenu2x.height() - 1);
-
-	bg.convertToDisplayFormat();
-	bg.blit(s, 0, 0);
+	getChrome("browse\n" + title + '\n' + subtitle, [&](Surface& bg) {
+		drawTitleIcon(bg, "icons/explorer.png", true);
+		writeTitle(bg, title);
+		writeSubTitle(bg, subtitle);
+		buttonBox.paint(bg, 5, gmenu2x.height() - 1);
+	}).blit(s, 0, 0);
 
 	// TODO(MtH): I have no idea what the right value of firstElement would be,
 	//            but originally it was undefined and that is never a good idea.
@@ -241,6 +247,10 @@ void BrowseDialog::paint()
 
 	offsetY = topBarHeight + 1;
 
+	rows->update(firstElement, fl.size(), [&](unsigned int i) {
+		rows->write(i, fl[i], 24, Font::VAlignMiddle);
+	});
+
 	//Files & Directories
 	s.setClipRect(clipRect);
 	for (i = firstElement; i < lastElement; i++) {
@@ -255,11 +265,10 @@ void BrowseDialog::paint()
 			icon = iconFile;
 		}
 		icon->blit(s, 5, offsetY);
-		gmenu2x.font->write(s, fl[i], 24, offsetY + rowHeight / 2,
-				Font::HAlignLeft, Font::VAlignMiddle);
 
 		offsetY += rowHeight;
 	}
+	rows->paint(s, 0, topBarHeight + 1);
 	s.clearClipRect();
 
 	gmenu2x.drawScrollBar(numRows,fl.size(), firstElement);
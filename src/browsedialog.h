@@ -25,8 +25,10 @@
 #include "dialog.h"
 #include "filelister.h"
 #include "inputmanager.h"
+#include "rowcache.h"
 
 #include <SDL.h>
+#include <memory>
 #include <string>
 
 class OffscreenSurface;
@@ -40,6 +42,7 @@ protected:
 	void setPath(const std::string &path) {
 		this->path = path;
 		fl.browse(path);
+		if (rows) rows->invalidate();
 	}
 
 	FileLister fl;
@@ -68,6 +71,7 @@ private:
 
 	unsigned int numRows;
 	unsigned int rowHeight;
+	std::unique_ptr<RowCache> rows;
 
 	OffscreenSurface *iconGoUp;
 	OffscreenSurface *iconFolder;
@@ -2,6 +2,7 @@
 
 #include "debug.h"
 #include "inputmanager.h"
+#include "reactor.h"
 #include "utilities.h"
 
 #include <SDL.h>
@@ -12,15 +13,14 @@
 class Clock::Timer {
 public:
 	Timer();
-	~Timer();
 	void start();
 	void getTime(unsigned int &hours, unsigned int &minutes);
-	unsigned int callback();
+	void callback();
 
 private:
 	unsigned int update();
 
-	SDL_TimerID timerID;
+	Reactor::Timer timer;
 	struct Timestamp { unsigned char hours, minutes; };
 	std::atomic<Timestamp> timestamp;
 };
@@ -46,33 +46,12 @@ static std::shared_ptr<Clock::Timer> globalTimerInstance()
 	}
 }
 
-extern "C" Uint32 callbackFunc(Uint32 /*timeout*/, void */*d*/)
-{
-	std::shared_ptr<Clock::Timer> timer = globalTimer.lock();
-	return timer ? timer->callback() : 0;
-}
-
 Clock::Timer::Timer()
-	: timerID(NULL) { }
-
-Clock::Timer::~Timer()
-{
-	if (timerID) {
-		SDL_RemoveTimer(timerID);
-	}
-}
+	: timer(std::bind(&Clock::Timer::callback, this)) { }
 
 void Clock::Timer::start()
 {
-	if (timerID) {
-		ERROR("SDL timer was already started\n");
-		return;
-	}
-	unsigned int ms = update();
-	timerID = SDL_AddTimer(ms, callbackFunc, this);
-	if (!timerID) {
-		ERROR("Could not initialize SDL timer: %s\n", SDL_GetError());
-	}
+	timer.start(update());
 }
 
 void Clock::Timer::getTime(unsigned int &hours, unsigned int &minutes)
@@ -100,27 +79,18 @@ unsigned int Clock::Timer::update()
 	// Compute number of milliseconds to next minute boundary.
 	// We don't need high precision, but it is important that any deviation is
 	// past the minute mark, so the fetched hour and minute number belong to
-	// the freshly started minute.
-	// TODO: Does the SDL timer in fact guarantee we're never called early?
-	//       "ms = t->interval - SDL_TIMESLICE;" worries me.
-	// Clamping it at 1 sec both avoids overloading the system in case our
-	// computation goes haywire and avoids passing 0 to SDL, which would stop
-	// the recurring timer.
+	// the freshly started minute; timerfd never fires early.
+	// Clamping it at 1 sec avoids overloading the system in case our
+	// computation goes haywire.
 	return std::max(1, (60 - local.tm_sec)) * 1000;
 }
 
-unsigned int Clock::Timer::callback()
+void Clock::Timer::callback()
 {
-	unsigned int ms = update();
+	// Rearmed every time, since minutes don't stay aligned to an interval.
+	timer.start(update());
 
 	request_repaint();
-
-	// TODO: SDL timer forgets adjusted interval if a timer was inserted or
-	//       removed during the callback. So we should either fix that bug
-	//       in SDL or ensure we don't insert/remove timers at runtime.
-	//       The blanking timer is inserted/removed quite a lot at time moment,
-	//       but it could be reprogrammed to adjust the interval instead.
-	return ms;
 }
 
 std::string Clock::getTime(bool is24)
@@ -0,0 +1,187 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "commandrunner.h"
+
+#include "debug.h"
+#include "utilities.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+extern char **environ;
+
+namespace {
+
+struct Job {
+	string key;
+	string command;
+	CommandRunner::Callback done;
+};
+
+struct Queue {
+	mutex lock;
+	condition_variable cond;
+	deque<Job> jobs;
+	bool busy = false;
+	bool started = false;
+};
+
+}
+
+/**
+ * The queue is never destroyed: the background thread is detached and may
+ * still be waiting on it while the program exits.
+ */
+static Queue &queue()
+{
+	static Queue *queue = new Queue;
+	return *queue;
+}
+
+static void worker()
+{
+	Queue &q = queue();
+	unique_lock<mutex> lock(q.lock);
+	for (;;) {
+		q.cond.wait(lock, [&q] { return !q.jobs.empty(); });
+		Job job = move(q.jobs.front());
+		q.jobs.pop_front();
+		q.busy = true;
+		lock.unlock();
+
+		string output;
+		int status = CommandRunner::run(job.command,
+				job.done ? &output : nullptr);
+		if (job.done) {
+			job.done(status, output);
+		}
+
+		lock.lock();
+		q.busy = false;
+		q.cond.notify_all();
+	}
+}
+
+/** Appends a job to the queue; the queue lock must be held. */
+static void push(Queue &q, Job&& job)
+{
+	q.jobs.push_back(move(job));
+	if (!q.started) {
+		thread(worker).detach();
+		q.started = true;
+	}
+	q.cond.notify_all();
+}
+
+int CommandRunner::run(string const& command, string *output)
+{
+	vector<string> args;
+	split(args, command, " ");
+	if (args.empty()) {
+		return -1;
+	}
+
+	vector<char *> argv;
+	argv.reserve(args.size() + 1);
+	for (auto& arg : args) {
+		argv.push_back(&arg[0]);
+	}
+	argv.push_back(nullptr);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+
+	int fds[2] = { -1, -1 };
+	if (output) {
+		output->clear();
+		if (pipe2(fds, O_CLOEXEC) < 0) {
+			WARNING("Unable to create pipe for '%s': %s\n",
+					command.c_str(), strerror(errno));
+			output = nullptr;
+		} else {
+			posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+		}
+	}
+
+	pid_t pid;
+	int err = posix_spawnp(&pid, argv[0], &actions, nullptr,
+			argv.data(), environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if (fds[1] >= 0) {
+		close(fds[1]);
+	}
+
+	if (err) {
+		WARNING("Unable to run '%s': %s\n", command.c_str(), strerror(err));
+		if (fds[0] >= 0) {
+			close(fds[0]);
+		}
+		return -1;
+	}
+
+	if (output) {
+		char buf[256];
+		for (;;) {
+			ssize_t n = read(fds[0], buf, sizeof(buf));
+			if (n > 0) {
+				output->append(buf, n);
+			} else if (n == 0 || errno != EINTR) {
+				break;
+			}
+		}
+		close(fds[0]);
+	}
+
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			WARNING("Unable to wait for '%s': %s\n",
+					command.c_str(), strerror(errno));
+			return -1;
+		}
+	}
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void CommandRunner::start(string const& command, Callback done)
+{
+	Queue &q = queue();
+	lock_guard<mutex> lock(q.lock);
+	push(q, { string(), command, move(done) });
+}
+
+void CommandRunner::set(string const& key, string const& command,
+		Callback done)
+{
+	Queue &q = queue();
+	lock_guard<mutex> lock(q.lock);
+	for (auto& job : q.jobs) {
+		if (!job.key.empty() && job.key == key) {
+			job.command = command;
+			job.done = move(done);
+			return;
+		}
+	}
+	push(q, { key, command, move(done) });
+}
+
+void CommandRunner::wait()
+{
+	Queue &q = queue();
+	unique_lock<mutex> lock(q.lock);
+	q.cond.wait(lock, [&q] { return q.jobs.empty() && !q.busy; });
+}
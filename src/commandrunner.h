@@ -0,0 +1,50 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __COMMANDRUNNER_H__
+#define __COMMANDRUNNER_H__
+
+#include <functional>
+#include <string>
+
+/**
+ * Runs the helper programs of the system (volume, brightness, audio_amp,
+ * ...) without going through a shell.
+ * A command is a program name followed by its arguments, separated by
+ * single spaces; there is no quoting or other shell syntax.
+ * Asynchronous commands are run one after the other, in the order they
+ * were queued, by a single background thread.
+ */
+class CommandRunner {
+public:
+	/**
+	 * Called on the background thread when a command has finished, with
+	 * the result of run() and everything the command wrote to stdout.
+	 */
+	typedef std::function<void(int status, std::string const& output)> Callback;
+
+	/**
+	 * Runs a command and waits for it to finish.
+	 * If 'output' is not null, it receives what the command wrote to stdout.
+	 * @return The exit status of the command, or -1 if it could not be
+	 *         started or was killed by a signal.
+	 */
+	static int run(std::string const& command, std::string *output = nullptr);
+
+	/** Queues a command to be run in the background. */
+	static void start(std::string const& command, Callback done = Callback());
+
+	/**
+	 * Queues a command that sets some state, such as the volume.
+	 * If a command with the same key is still waiting in the queue, it is
+	 * replaced by this one and its callback is never called: only the last
+	 * value set matters.
+	 */
+	static void set(std::string const& key, std::string const& command,
+			Callback done = Callback());
+
+	/** Waits until all queued commands have finished. */
+	static void wait();
+};
+
+#endif // __COMMANDRUNNER_H__
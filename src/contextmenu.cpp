@@ -92,8 +92,7 @@ ContextMenu::ContextMenu(GMenu2X &gmenu2x, Menu &menu)
 	};
 
 	// Init background fade animation.
-	tickStart = SDL_GetTicks();
-	fadeAlpha = 0;
+	fade.start(0, 200, 500);
 
 	if (options.empty())
 		dismiss();
@@ -101,11 +100,7 @@ ContextMenu::ContextMenu(GMenu2X &gmenu2x, Menu &menu)
 
 bool ContextMenu::runAnimations()
 {
-	if (fadeAlpha < 200) {
-		const long tickNow = SDL_GetTicks();
-		fadeAlpha = intTransition(0, 200, tickStart, 500, tickNow);
-	}
-	return fadeAlpha < 200;
+	return fade.isRunning();
 }
 
 void ContextMenu::paint(Surface &s)
@@ -114,7 +109,7 @@ void ContextMenu::paint(Surface &s)
 
 	// Darken background.
 	s.box(0, 0, gmenu2x.width(), gmenu2x.height(),
-	      0, 0, 0, fadeAlpha);
+	      0, 0, 0, fade.currentValue());
 
 	// Draw popup box.
 	s.box(box, gmenu2x.skinConfColors[COLOR_MESSAGE_BOX_BG]);
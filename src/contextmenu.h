@@ -4,6 +4,7 @@
 #ifndef __CONTEXTMENU_H__
 #define __CONTEXTMENU_H__
 
+#include "animation.h"
 #include "layer.h"
 
 #include <SDL.h>
@@ -23,6 +24,7 @@ public:
 	virtual bool runAnimations();
 	virtual void paint(Surface &s);
 	virtual bool handleButtonPress(InputManager::Button button);
+	virtual const char *getName() { return "context menu"; }
 
 private:
 	struct MenuOption;
@@ -32,9 +34,8 @@ private:
 	std::vector<std::shared_ptr<MenuOption>> options;
 	SDL_Rect box;
 
-	int fadeAlpha;
+	Animation fade;
 	int selected;
-	long tickStart;
 };
 
 #endif // __CONTEXTMENU_H__
@@ -2,7 +2,7 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
-#include <cstdio>
+#include "log.h"
 
 #define NODEBUG_L 0
 #define ERROR_L 1
@@ -10,6 +10,9 @@
 #define INFO_L 3
 #define DEBUG_L 4
 
+// Messages above LOG_LEVEL are compiled out; the others are written by a
+// background thread, see log.h.
+
 #ifndef LOG_LEVEL
 #define LOG_LEVEL INFO_L
 #endif
@@ -31,10 +34,10 @@
 #if (LOG_LEVEL >= DEBUG_L)
 # ifdef COLOR_DEBUG
 #  define DEBUG(str, ...) \
-    fprintf(stdout, COLOR_DEBUG "DEBUG: " str COLOR_END, ##__VA_ARGS__)
+    LOG_MESSAGE(stdout, COLOR_DEBUG "DEBUG: " str COLOR_END, ##__VA_ARGS__)
 # else
 #  define DEBUG(...) \
-    fprintf(stdout, "DEBUG: " __VA_ARGS__)
+    LOG_MESSAGE(stdout, "DEBUG: " __VA_ARGS__)
 # endif
 #else
 #define DEBUG(...)
@@ -43,10 +46,10 @@
 #if (LOG_LEVEL >= INFO_L)
 # ifdef COLOR_INFO
 #  define INFO(str, ...) \
-    fprintf(stdout, COLOR_INFO str COLOR_END, ##__VA_ARGS__)
+    LOG_MESSAGE(stdout, COLOR_INFO str COLOR_END, ##__VA_ARGS__)
 # else
 #  define INFO(...) \
-    fprintf(stdout, __VA_ARGS__)
+    LOG_MESSAGE(stdout, __VA_ARGS__)
 # endif
 #else
 #define INFO(...)
@@ -55,10 +58,10 @@
 #if (LOG_LEVEL >= WARNING_L)
 # ifdef COLOR_WARNING
 #  define WARNING(str, ...) \
-    fprintf(stderr, COLOR_WARNING "WARNING: " str COLOR_END, ##__VA_ARGS__)
+    LOG_MESSAGE(stderr, COLOR_WARNING "WARNING: " str COLOR_END, ##__VA_ARGS__)
 # else
 #  define WARNING(...) \
-    fprintf(stderr, "WARNING: " __VA_ARGS__)
+    LOG_MESSAGE(stderr, "WARNING: " __VA_ARGS__)
 # endif
 #else
 #define WARNING(...)
@@ -67,10 +70,10 @@
 #if (LOG_LEVEL >= ERROR_L)
 # ifdef COLOR_ERROR
 #  define ERROR(str, ...) \
-    fprintf(stderr, COLOR_ERROR "ERROR: " str COLOR_END, ##__VA_ARGS__)
+    LOG_MESSAGE(stderr, COLOR_ERROR "ERROR: " str COLOR_END, ##__VA_ARGS__)
 # else
 #  define ERROR(...) \
-    fprintf(stderr, "ERROR: " __VA_ARGS__)
+    LOG_MESSAGE(stderr, "ERROR: " __VA_ARGS__)
 # endif
 #else
 #define ERROR(...)
@@ -1,14 +1,58 @@
+#include <list>
+#include <memory>
 #include <string>
 
 #include "dialog.h"
 #include "gmenu2x.h"
 #include "font_stack.h"
+#include "surface.h"
 #include "word_wrap.h"
 
+namespace {
+
+struct Chrome {
+	std::string key;
+	std::unique_ptr<OffscreenSurface> surface;
+};
+
+}
+
+/** Most recently used first. Each one is as big as the screen. */
+static std::list<Chrome> chromeCache;
+static const size_t CHROME_CACHE_SIZE = 3;
+
 Dialog::Dialog(GMenu2X& gmenu2x) : gmenu2x(gmenu2x)
 {
 }
 
+void Dialog::clearChromeCache()
+{
+	chromeCache.clear();
+}
+
+Surface &Dialog::getChrome(std::string const& key,
+		std::function<void(Surface&)> const& draw)
+{
+	for (auto it = chromeCache.begin(); it != chromeCache.end(); ++it) {
+		if (it->key == key) {
+			chromeCache.splice(chromeCache.begin(), chromeCache, it);
+			return *it->surface;
+		}
+	}
+
+	std::unique_ptr<OffscreenSurface> surface(
+			new OffscreenSurface(*gmenu2x.bg));
+	surface->setUse(SurfaceUse::DIALOG);
+	draw(*surface);
+	surface->convertToDisplayFormat();
+
+	if (chromeCache.size() >= CHROME_CACHE_SIZE) {
+		chromeCache.pop_back();
+	}
+	chromeCache.push_front(Chrome { key, std::move(surface) });
+	return *chromeCache.front().surface;
+}
+
 void Dialog::drawTitleIcon(Surface& s, const std::string &icon, bool skinRes)
 {
 	Surface *i = NULL;
@@ -1,6 +1,7 @@
 #ifndef __DIALOG_H__
 #define __DIALOG_H__
 
+#include <functional>
 #include <string>
 
 class GMenu2X;
@@ -11,11 +12,24 @@ class Dialog
 public:
 	Dialog(GMenu2X& gmenu2x);
 
+	/** Drops the cached chrome; needed when the wallpaper or skin changed. */
+	static void clearChromeCache();
+
 protected:
 	void drawTitleIcon(Surface& s, const std::string &icon, bool skinRes = false);
 	void writeTitle(Surface& s, const std::string &title);
 	void writeSubTitle(Surface& s, const std::string &subtitle);
 
+	/**
+	 * Returns the wallpaper with the chrome of the dialog drawn over it by
+	 * 'draw', in the display format.
+	 * The result is cached under 'key', which must tell apart everything
+	 * 'draw' puts on it (title, subtitle, icon, buttons), so that it can
+	 * be reused across frames and by later dialogs.
+	 */
+	Surface &getChrome(std::string const& key,
+			std::function<void(Surface&)> const& draw);
+
 	GMenu2X& gmenu2x;
 };
 
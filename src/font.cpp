@@ -63,6 +63,21 @@ Font::~Font()
 	}
 }
 
+/** Returns the left edge of text of the given width aligned on 'x'. */
+static int alignX(int x, int width, Font::HAlign halign) {
+	switch (halign) {
+	case Font::HAlignLeft:
+		break;
+	case Font::HAlignCenter:
+		x -= width / 2;
+		break;
+	case Font::HAlignRight:
+		x -= width;
+		break;
+	}
+	return x;
+}
+
 int Font::writeLine(Surface& surface, const std::uint16_t *text, int x, int y,
                     HAlign halign, VAlign valign) const {
 	if (*text == 0) {
@@ -81,6 +96,10 @@ int Font::writeLine(Surface& surface, const std::uint16_t *text, int x, int y,
 		break;
 	}
 
+	if (surface.isRGB565()) {
+		return writeLineRGB565(surface, text, x, y, halign);
+	}
+
 	SDL_Color color = { 0, 0, 0, 0 };
 	SDL_Surface *s = TTF_RenderUNICODE_Blended(font, text, color);
 	if (!s) {
@@ -89,17 +108,7 @@ int Font::writeLine(Surface& surface, const std::uint16_t *text, int x, int y,
 		return 0;
 	}
 	const int width = s->w;
-
-	switch (halign) {
-	case HAlignLeft:
-		break;
-	case HAlignCenter:
-		x -= width / 2;
-		break;
-	case HAlignRight:
-		x -= width;
-		break;
-	}
+	x = alignX(x, width, halign);
 
 	SDL_Rect rect = { (Sint16) x, (Sint16) (y - 1), 0, 0 };
 	SDL_BlitSurface(s, NULL, surface.raw, &rect);
@@ -136,3 +145,29 @@ int Font::writeLine(Surface& surface, const std::uint16_t *text, int x, int y,
 
 	return width;
 }
+
+int Font::writeLineRGB565(Surface& surface, const std::uint16_t *text,
+                          int x, int y, HAlign halign) const {
+	// Render the coverage of the glyphs once and blend it straight into the
+	// surface, for the outline as well as the text, instead of rendering
+	// two 32-bit surfaces and converting them on every blit.
+	SDL_Color white = { 0xff, 0xff, 0xff, 0 }, black = { 0, 0, 0, 0 };
+	SDL_Surface *mask = TTF_RenderUNICODE_Shaded(font, text, white, black);
+	if (!mask) {
+		ERROR("Font rendering failed: %s\n", SDL_GetError());
+		SDL_ClearError();
+		return 0;
+	}
+	const int width = mask->w;
+	x = alignX(x, width, halign);
+
+	const RGBAColor outline(0, 0, 0), fill(0xff, 0xff, 0xff);
+	surface.blendMask(mask, x, y - 1, outline);
+	surface.blendMask(mask, x, y + 1, outline);
+	surface.blendMask(mask, x - 1, y, outline);
+	surface.blendMask(mask, x + 1, y, outline);
+	surface.blendMask(mask, x, y, fill);
+	SDL_FreeSurface(mask);
+
+	return width;
+}
@@ -59,6 +59,12 @@ private:
 	 */
 	int writeLine(Surface& surface, const std::uint16_t *text, int x, int y,
 	              HAlign halign, VAlign valign) const;
+	/**
+	 * Draws a line on an RGB565 surface by blending the glyph coverage
+	 * directly; 'y' is the top of the line.
+	 */
+	int writeLineRGB565(Surface& surface, const std::uint16_t *text,
+	                    int x, int y, HAlign halign) const;
 
 	TTF_Font *font;
 	int lineSpacing;
@@ -1,4 +1,9 @@
 #include "funkeymenu.h"
+#include "brightnessmanager.h"
+#include "commandrunner.h"
+#include "mixer.h"
+#include "utilities.h"
+#include <atomic>
 #include <iostream>
 
 /// -------------- DEFINES --------------
@@ -64,6 +69,7 @@ TTF_Font *FunkeyMenu::menu_info_font = NULL;
 TTF_Font *FunkeyMenu::menu_small_info_font = NULL;
 SDL_Surface *img_arrow_top = NULL;
 SDL_Surface *img_arrow_bottom = NULL;
+SDL_Surface *img_zone_bg = NULL;
 SDL_Surface ** FunkeyMenu::menu_zone_surfaces = NULL;
 int *FunkeyMenu::idx_menus = NULL;
 int FunkeyMenu::nb_menu_zones = 0;
@@ -90,12 +96,22 @@ int FunkeyMenu::aspect_ratio_factor_percent = 50;
 int FunkeyMenu::aspect_ratio_factor_step = 10;
 
 GMenu2X *FunkeyMenu::gmenu2x_ptr = NULL;
+Mixer *FunkeyMenu::mixer = NULL;
 int FunkeyMenu::savestate_slot = 0;
 
 /// USB stuff
 int usb_data_connected = 0;
 int usb_sharing = 0;
 
+/// System values fetched in the background, -1 until they arrive
+static std::atomic<int> fetched_volume(-1);
+static std::atomic<int> fetched_brightness(-1);
+static std::atomic<int> fetched_usb_data_connected(-1);
+static std::atomic<int> fetched_usb_sharing(-1);
+/// Set when the user changes a value before its fetch has completed
+static bool volume_changed = false;
+static bool brightness_changed = false;
+
 
 /// -------------- FUNCTIONS IMPLEMENTATION --------------
 void FunkeyMenu::init(GMenu2X &gmenu2x)
@@ -118,6 +134,14 @@ void FunkeyMenu::init(GMenu2X &gmenu2x)
 	/// ------ Save GMenu2X instance pointer ------
 	gmenu2x_ptr = &gmenu2x;
 
+	/// ------ Open the mixer, if the config names the volume element ------
+	/// Its name depends on the audio driver, so there is no default; without
+	/// it, the helper script sets the volume
+	std::string const& mixerElement = gmenu2x.confStr["mixerElement"];
+	if(!mixerElement.empty()){
+		mixer = new Mixer(mixerElement);
+	}
+
 	/// ----- Copy draw_screen at init ------
 	SDL_Surface * hw_screen = gmenu2x_ptr->s->getSurface();
 	backup_hw_screen = SDL_CreateRGBSurface(SDL_SWSURFACE,
@@ -130,6 +154,8 @@ void FunkeyMenu::init(GMenu2X &gmenu2x)
 	if(draw_screen == NULL){
 		MENU_ERROR_PRINTF("ERROR in init_menu_SDL: Could not create backup_hw_screen: %s\n", SDL_GetError());
 	}
+	SurfaceMemory::add(SurfaceUse::FUNKEY_MENU, backup_hw_screen);
+	SurfaceMemory::add(SurfaceUse::FUNKEY_MENU, draw_screen);
 
 	/// ------ Load arrows imgs -------
 	img_arrow_top = IMG_Load(MENU_PNG_ARROW_TOP_PATH);
@@ -140,6 +166,8 @@ void FunkeyMenu::init(GMenu2X &gmenu2x)
 	if(!img_arrow_bottom) {
 		MENU_ERROR_PRINTF("ERROR IMG_Load: %s\n", IMG_GetError());
 	}
+	SurfaceMemory::add(SurfaceUse::FUNKEY_MENU, img_arrow_top);
+	SurfaceMemory::add(SurfaceUse::FUNKEY_MENU, img_arrow_bottom);
 
 	/// ------ Init menu zones ------
 	init_menu_zones();
@@ -159,15 +187,31 @@ void FunkeyMenu::end( )
 	/// ------ Free Surfaces -------
 	for(int i=0; i < nb_menu_zones; i++){
 		if(menu_zone_surfaces[i] != NULL){
+			SurfaceMemory::remove(SurfaceUse::FUNKEY_MENU, menu_zone_surfaces[i]);
 			SDL_FreeSurface(menu_zone_surfaces[i]);
 		}
 	}
 	if(backup_hw_screen != NULL){
+		SurfaceMemory::remove(SurfaceUse::FUNKEY_MENU, backup_hw_screen);
 		SDL_FreeSurface(backup_hw_screen);
 	}
+	if(draw_screen != NULL){
+		SurfaceMemory::remove(SurfaceUse::FUNKEY_MENU, draw_screen);
+		SDL_FreeSurface(draw_screen);
+		draw_screen = NULL;
+	}
 
+	SurfaceMemory::remove(SurfaceUse::FUNKEY_MENU, img_arrow_top);
+	SurfaceMemory::remove(SurfaceUse::FUNKEY_MENU, img_arrow_bottom);
+	SurfaceMemory::remove(SurfaceUse::FUNKEY_MENU, img_zone_bg);
 	SDL_FreeSurface(img_arrow_top);
 	SDL_FreeSurface(img_arrow_bottom);
+	SDL_FreeSurface(img_zone_bg);
+	img_zone_bg = NULL;
+
+	/// ------ Close mixer -------
+	delete mixer;
+	mixer = NULL;
 
 	/// ------ Free Menu memory and reset vars -----
 	if(idx_menus){
@@ -188,10 +232,8 @@ bool FunkeyMenu::executeRawPath(const char *shellCmd)
     bool retVal = false;
 
     MENU_DEBUG_PRINTF( "Attempting to launch: %s\n", shellCmd);
-    std::string executionString = "exec " + std::string(shellCmd);
-    MENU_DEBUG_PRINTF("Running: %s\n", executionString.c_str());
 
-    if(system(executionString.c_str()) != 0)
+    if(CommandRunner::run(shellCmd) != 0)
     {
     	//MENU_ERROR_PRINTF( "Failed to launch: %s\n", shellCmd);
     }
@@ -204,6 +246,84 @@ bool FunkeyMenu::executeRawPath(const char *shellCmd)
     return retVal;
 }
 
+/// Returns the percentage printed by a "get" helper command, or -1
+int FunkeyMenu::parse_system_value(const char *shellCmd, int status, std::string const& res)
+{
+    if(status < 0){
+        MENU_ERROR_PRINTF("Failed to run command %s\n", shellCmd);
+        return -1;
+    }
+
+    /// Check if the value is a number (at least the first char)
+    if(res.empty() || res[0] < '0' || res[0] > '9'){
+        MENU_ERROR_PRINTF("Wrong return value: %s for cmd: %s\n", res.c_str(), shellCmd);
+        return -1;
+    }
+
+    return atoi(res.c_str());
+}
+
+/// Queued, so that only the last of several quick changes is run
+static void queue_volume_set(int percentage)
+{
+    CommandRunner::set("volume", std::string(SHELL_CMD_VOLUME_SET) + " " + std::to_string(percentage),
+            [](int status, std::string const&) {
+                if(status != 0){
+                    MENU_ERROR_PRINTF("Failed to run command %s\n", SHELL_CMD_VOLUME_SET);
+                }
+            });
+}
+
+void FunkeyMenu::set_volume(int percentage)
+{
+    volume_changed = true;
+
+    /// Apply it right away through the mixer if one is configured; the
+    /// helper script is then only run once, when the menu closes
+    if(mixer && mixer->available()){
+        if(!mixer->setVolume(percentage)){
+            MENU_ERROR_PRINTF("Failed to set volume to %d%%\n", percentage);
+        }
+    } else {
+        queue_volume_set(percentage);
+    }
+}
+
+void FunkeyMenu::store_volume()
+{
+    if(!volume_changed){
+        return;
+    }
+
+    /// The helper script also stores the volume, so that it survives a
+    /// reboot; the mixer doesn't
+    if(mixer && mixer->available()){
+        queue_volume_set(volume_percentage);
+    }
+
+    // Turn audio amp off to avoid buzzing sound
+    CommandRunner::set("audio_amp", SHELL_CMD_AUDIO_AMP_OFF);
+}
+
+void FunkeyMenu::set_brightness(int percentage)
+{
+    brightness_changed = true;
+
+    /// Apply it right away if the backlight can be reached through sysfs
+    BrightnessManager *brightness = gmenu2x_ptr->getBrightnessManager();
+    if(brightness && brightness->available()){
+        brightness->setBrightness(
+                (brightness->maxBrightness() * percentage + 50) / 100);
+    }
+
+    CommandRunner::set("brightness", std::string(SHELL_CMD_BRIGHTNESS_SET) + " " + std::to_string(percentage),
+            [](int status, std::string const&) {
+                if(status != 0){
+                    MENU_ERROR_PRINTF("Failed to run command %s\n", SHELL_CMD_BRIGHTNESS_SET);
+                }
+            });
+}
+
 void FunkeyMenu::draw_progress_bar(SDL_Surface * surface, uint16_t x, uint16_t y, uint16_t width,
 		uint16_t height, uint8_t percentage, uint16_t nb_bars){
 	/// ------ Init Variables ------
@@ -269,15 +389,35 @@ void FunkeyMenu::add_menu_zone(ENUM_MENU_TYPE menu_type){
 	}
 	idx_menus[nb_menu_zones-1] = menu_type;
 
-	/// ------ Reinit menu surface with height increased -------
-	menu_zone_surfaces[nb_menu_zones-1] = IMG_Load(MENU_PNG_BG_PATH);
-	if(!menu_zone_surfaces[nb_menu_zones-1]) {
-		MENU_ERROR_PRINTF("ERROR IMG_Load: %s\n", IMG_GetError());
+	/// ------ Rendered the first time it is shown -------
+	menu_zone_surfaces[nb_menu_zones-1] = NULL;
+}
+
+SDL_Surface *FunkeyMenu::get_menu_zone(int idx){
+	if(menu_zone_surfaces[idx]){
+		return menu_zone_surfaces[idx];
 	}
+	ENUM_MENU_TYPE menu_type = (ENUM_MENU_TYPE) idx_menus[idx];
+
+	/// ------ Every zone starts from a copy of the same background -------
+	if(!img_zone_bg){
+		img_zone_bg = IMG_Load(MENU_PNG_BG_PATH);
+		if(!img_zone_bg) {
+			MENU_ERROR_PRINTF("ERROR IMG_Load: %s\n", IMG_GetError());
+			return NULL;
+		}
+		SurfaceMemory::add(SurfaceUse::FUNKEY_MENU, img_zone_bg);
+	}
+	menu_zone_surfaces[idx] = SDL_ConvertSurface(img_zone_bg, img_zone_bg->format, SDL_SWSURFACE);
+	if(!menu_zone_surfaces[idx]) {
+		MENU_ERROR_PRINTF("ERROR Could not copy zone background: %s\n", SDL_GetError());
+		return NULL;
+	}
+	SurfaceMemory::add(SurfaceUse::FUNKEY_MENU, menu_zone_surfaces[idx]);
 
 	/// --------- Init Common Variables --------
 	SDL_Surface *text_surface = NULL;
-	SDL_Surface *surface = menu_zone_surfaces[nb_menu_zones-1];
+	SDL_Surface *surface = menu_zone_surfaces[idx];
 	SDL_Rect text_pos;
 
 	/// --------- Add new zone ---------
@@ -370,12 +510,14 @@ void FunkeyMenu::add_menu_zone(ENUM_MENU_TYPE menu_type){
 		SDL_BlitSurface(text_surface, NULL, surface, &text_pos);
 		break;
 	default:
-		MENU_DEBUG_PRINTF("Warning - In add_menu_zone, unknown MENU_TYPE: %d\n", menu_type);
+		MENU_DEBUG_PRINTF("Warning - In get_menu_zone, unknown MENU_TYPE: %d\n", menu_type);
 		break;
 	}
 
 	/// ------ Free Surfaces -------
 	SDL_FreeSurface(text_surface);
+
+	return surface;
 }
 
 void FunkeyMenu::init_menu_zones(){
@@ -400,55 +542,72 @@ void FunkeyMenu::init_menu_zones(){
 }
 
 
-void FunkeyMenu::init_menu_system_values(){
-	FILE *fp;
-	char res[100];
+void FunkeyMenu::request_menu_system_values(){
+	volume_changed = false;
+	brightness_changed = false;
 
 	/// ------- Get system volume percentage --------
-	fp = popen(SHELL_CMD_VOLUME_GET, "r");
-	if (fp == NULL) {
-		MENU_ERROR_PRINTF("Failed to run command %s\n", SHELL_CMD_VOLUME_GET );
-		volume_percentage = 50; ///wrong value: setting default to 50
+	int volume = (mixer && mixer->available())? mixer->getVolume() : -1;
+	if(volume >= 0){
+		volume_percentage = volume;
 	}
 	else{
-		fgets(res, sizeof(res)-1, fp);
-		pclose(fp);
-
-		/// Check if Volume is a number (at least the first char)
-		if(res[0] < '0' || res[0] > '9'){
-			MENU_ERROR_PRINTF("Wrong return value: %s for volume cmd: %s\n",res, SHELL_CMD_VOLUME_GET);
-			volume_percentage = 50; ///wrong value: setting default to 50
-		}
-		else{
-			volume_percentage = atoi(res);
-			MENU_DEBUG_PRINTF("System volume = %d%%\n", volume_percentage);
-		}
+		CommandRunner::start(SHELL_CMD_VOLUME_GET, [](int status, std::string const& res) {
+			fetched_volume = parse_system_value(SHELL_CMD_VOLUME_GET, status, res);
+			request_repaint();
+		});
 	}
 
 	/// ------- Get system brightness percentage -------
-	fp = popen(SHELL_CMD_BRIGHTNESS_GET, "r");
-	if (fp == NULL) {
-		MENU_ERROR_PRINTF("Failed to run command %s\n", SHELL_CMD_BRIGHTNESS_GET );
-		brightness_percentage = 50; ///wrong value: setting default to 50
-	}
-	else{
-		fgets(res, sizeof(res)-1, fp);
-		pclose(fp);
+	CommandRunner::start(SHELL_CMD_BRIGHTNESS_GET, [](int status, std::string const& res) {
+		fetched_brightness = parse_system_value(SHELL_CMD_BRIGHTNESS_GET, status, res);
+		request_repaint();
+	});
 
-		/// Check if brightness is a number (at least the first char)
-		if(res[0] < '0' || res[0] > '9'){
-			MENU_ERROR_PRINTF("Wrong return value: %s for volume cmd: %s\n",res, SHELL_CMD_BRIGHTNESS_GET);
-			brightness_percentage = 50; ///wrong value: setting default to 50
-		}
-		else{
-			brightness_percentage = atoi(res);
-			MENU_DEBUG_PRINTF("System brightness = %d%%\n", brightness_percentage);
-		}
+	/// ------- Get USB Value -------
+	CommandRunner::start(SHELL_CMD_SHARE_IS_USB_DATA_CONNECTED, [](int status, std::string const&) {
+		fetched_usb_data_connected = (status == 0);
+		request_repaint();
+	});
+	CommandRunner::start(SHELL_CMD_SHARE_IS_SHARING, [](int status, std::string const&) {
+		fetched_usb_sharing = (status == 0);
+		request_repaint();
+	});
+}
+
+/// Takes the values fetched in the background; returns true if any arrived
+bool FunkeyMenu::apply_menu_system_values(){
+	bool changed = false;
+	int value;
+
+	/// ------- Keep what the user already changed --------
+	value = fetched_volume.exchange(-1);
+	if(value >= 0 && !volume_changed){
+		volume_percentage = value;
+		MENU_DEBUG_PRINTF("System volume = %d%%\n", volume_percentage);
+		changed = true;
+	}
+	value = fetched_brightness.exchange(-1);
+	if(value >= 0 && !brightness_changed){
+		brightness_percentage = value;
+		MENU_DEBUG_PRINTF("System brightness = %d%%\n", brightness_percentage);
+		changed = true;
 	}
 
-	/// ------- Get USB Value -------
-	usb_data_connected = executeRawPath(SHELL_CMD_SHARE_IS_USB_DATA_CONNECTED);
-	usb_sharing = executeRawPath(SHELL_CMD_SHARE_IS_SHARING);
+	/// ------- USB state -------
+	value = fetched_usb_data_connected.exchange(-1);
+	if(value >= 0){
+		usb_data_connected = value;
+		changed = true;
+	}
+	value = fetched_usb_sharing.exchange(-1);
+	if(value >= 0){
+		usb_sharing = value;
+		changed = true;
+	}
+	if(!changed){
+		return false;
+	}
 
 	/** Sanity check if usb not connected */
 	if(!usb_data_connected){
@@ -471,6 +630,7 @@ void FunkeyMenu::init_menu_system_values(){
 			}
 		}
 	}
+	return true;
 }
 
 void FunkeyMenu::menu_screen_refresh(int menuItem, int prevItem, int scroll, uint8_t menu_confirmation, uint8_t menu_action){
@@ -490,7 +650,7 @@ void FunkeyMenu::menu_screen_refresh(int menuItem, int prevItem, int scroll, uin
 	/// --------- Blit prev menu Zone going away ----------
 	menu_blit_window.y = scroll;
 	menu_blit_window.h = SCREEN_VERTICAL_SIZE;
-	if(SDL_BlitSurface(menu_zone_surfaces[prevItem], &menu_blit_window, draw_screen, NULL)){
+	if(SDL_BlitSurface(get_menu_zone(prevItem), &menu_blit_window, draw_screen, NULL)){
 		MENU_ERROR_PRINTF("ERROR Could not Blit surface on draw_screen: %s\n", SDL_GetError());
 	}
 
@@ -498,14 +658,14 @@ void FunkeyMenu::menu_screen_refresh(int menuItem, int prevItem, int scroll, uin
 	if(scroll>0){
 		menu_blit_window.y = SCREEN_VERTICAL_SIZE-scroll;
 		menu_blit_window.h = SCREEN_VERTICAL_SIZE;
-		if(SDL_BlitSurface(menu_zone_surfaces[menuItem], NULL, draw_screen, &menu_blit_window)){
+		if(SDL_BlitSurface(get_menu_zone(menuItem), NULL, draw_screen, &menu_blit_window)){
 			MENU_ERROR_PRINTF("ERROR Could not Blit surface on draw_screen: %s\n", SDL_GetError());
 		}
 	}
 	else if(scroll<0){
 		menu_blit_window.y = SCREEN_VERTICAL_SIZE+scroll;
 		menu_blit_window.h = SCREEN_VERTICAL_SIZE;
-		if(SDL_BlitSurface(menu_zone_surfaces[menuItem], &menu_blit_window, draw_screen, NULL)){
+		if(SDL_BlitSurface(get_menu_zone(menuItem), &menu_blit_window, draw_screen, NULL)){
 			MENU_ERROR_PRINTF("ERROR Could not Blit surface on draw_screen: %s\n", SDL_GetError());
 		}
 	}
@@ -527,7 +687,7 @@ void FunkeyMenu::menu_screen_refresh(int menuItem, int prevItem, int scroll, uin
 			break;
 
 		case MENU_TYPE_BRIGHTNESS:
-			draw_progress_bar(draw_screen, x_volume_bar, y_volume_bar,
+			draw_progress_bar(draw_screen, x_brightness_bar, y_brightness_bar,
 					width_progress_bar, height_progress_bar, brightness_percentage, 100/STEP_CHANGE_BRIGHTNESS);
 			break;
 
@@ -699,14 +859,14 @@ int FunkeyMenu::launch( )
 	int scroll=0;
 	int start_scroll=0;
 	uint8_t screen_refresh = 1;
-	char shell_cmd[100];
 	uint8_t menu_confirmation = 0;
 	stop_menu_loop = 0;
 	char fname[MAXPATHLEN];
 	int returnCode = MENU_RETURN_OK;
 
-	/// ------ Get System values -------
-	init_menu_system_values();
+	/// ------ Show the last known system values, fetch the current ones -------
+	apply_menu_system_values();
+	request_menu_system_values();
 	int prevItem=menuItem;
 
 	/// Save prev key repeat params and set new Key repeat
@@ -729,13 +889,22 @@ int FunkeyMenu::launch( )
 	{
 		/// -------- Handle Keyboard Events ---------
 		if(!scroll){
-			while (SDL_PollEvent(&event))
+			/// Sleep until something happens, unless there is a refresh to do
+			int got_event = screen_refresh? SDL_PollEvent(&event) : SDL_WaitEvent(&event);
+			for (; got_event; got_event = SDL_PollEvent(&event))
 				switch(event.type)
 				{
 				case SDL_QUIT:
 					stop_menu_loop = 1;
 					returnCode = MENU_RETURN_EXIT;
 					break;
+				case SDL_USEREVENT:
+					/// ------ System values fetched in the background ------
+					if(apply_menu_system_values()){
+						prevItem = menuItem;
+						screen_refresh = 1;
+					}
+					break;
 				case SDL_KEYDOWN:
 					switch (event.key.keysym.sym)
 					{
@@ -824,11 +993,8 @@ int FunkeyMenu::launch( )
 							volume_percentage = (volume_percentage < STEP_CHANGE_VOLUME)?
 									0:(volume_percentage-STEP_CHANGE_VOLUME);
 
-							/// ----- Shell cmd ----
-							sprintf(shell_cmd, "%s %d", SHELL_CMD_VOLUME_SET, volume_percentage);
-							system(shell_cmd);
-							// Turn audio amp off to avoid buzzing sound
-							system(SHELL_CMD_AUDIO_AMP_OFF);
+							/// ----- Apply it ----
+							set_volume(volume_percentage);
 
 							/// ------ Refresh screen ------
 							screen_refresh = 1;
@@ -839,9 +1005,8 @@ int FunkeyMenu::launch( )
 							brightness_percentage = (brightness_percentage < STEP_CHANGE_BRIGHTNESS)?
 									0:(brightness_percentage-STEP_CHANGE_BRIGHTNESS);
 
-							/// ----- Shell cmd ----
-							sprintf(shell_cmd, "%s %d", SHELL_CMD_BRIGHTNESS_SET, brightness_percentage);
-							system(shell_cmd);
+							/// ----- Apply it ----
+							set_brightness(brightness_percentage);
 
 							/// ------ Refresh screen ------
 							screen_refresh = 1;
@@ -882,11 +1047,8 @@ int FunkeyMenu::launch( )
 							volume_percentage = (volume_percentage > 100 - STEP_CHANGE_VOLUME)?
 									100:(volume_percentage+STEP_CHANGE_VOLUME);
 
-							/// ----- Shell cmd ----
-							sprintf(shell_cmd, "%s %d", SHELL_CMD_VOLUME_SET, volume_percentage);
-							system(shell_cmd);
-							// Turn audio amp off to avoid buzzing sound
-							system(SHELL_CMD_AUDIO_AMP_OFF);
+							/// ----- Apply it ----
+							set_volume(volume_percentage);
 
 							/// ------ Refresh screen ------
 							screen_refresh = 1;
@@ -897,9 +1059,8 @@ int FunkeyMenu::launch( )
 							brightness_percentage = (brightness_percentage > 100 - STEP_CHANGE_BRIGHTNESS)?
 									100:(brightness_percentage+STEP_CHANGE_BRIGHTNESS);
 
-							/// ----- Shell cmd ----
-							sprintf(shell_cmd, "%s %d", SHELL_CMD_BRIGHTNESS_SET, brightness_percentage);
-							system(shell_cmd);
+							/// ----- Apply it ----
+							set_brightness(brightness_percentage);
 
 							/// ------ Refresh screen ------
 							screen_refresh = 1;
@@ -976,7 +1137,8 @@ int FunkeyMenu::launch( )
 								/*system(usb_sharing?SHELL_CMD_SHARE_STOP:SHELL_CMD_SHARE_START);*/
 								bool res = executeRawPath(usb_sharing?SHELL_CMD_SHARE_STOP:SHELL_CMD_SHARE_START);
 								if (!res) {
-									MENU_ERROR_PRINTF("Failed to run command %s\n", shell_cmd);
+									MENU_ERROR_PRINTF("Failed to run command %s\n",
+											usb_sharing?SHELL_CMD_SHARE_STOP:SHELL_CMD_SHARE_START);
 								}
 								else{
 									usb_sharing = !usb_sharing;
@@ -1037,9 +1199,10 @@ int FunkeyMenu::launch( )
 								/// ------ Refresh Screen -------
 								menu_screen_refresh(menuItem, prevItem, scroll, menu_confirmation, 1);
 
-								/// ----- Shell cmd ----
-								sprintf(shell_cmd, "%s", SHELL_CMD_POWERDOWN);
-								system(shell_cmd);
+								/// ----- Let pending settings be stored, then power down ----
+								store_volume();
+								CommandRunner::wait();
+								CommandRunner::run(SHELL_CMD_POWERDOWN);
 
 								return MENU_RETURN_EXIT;
 							}
@@ -1077,10 +1240,12 @@ int FunkeyMenu::launch( )
 			screen_refresh = 1;
 		}
 
-		/// --------- Handle FPS ---------
-		cur_ms = SDL_GetTicks();
-		if(cur_ms-prev_ms < 1000/FPS_MENU){
-			SDL_Delay(1000/FPS_MENU - (cur_ms-prev_ms));
+		/// --------- Handle FPS (only while scrolling) ---------
+		if(scroll){
+			cur_ms = SDL_GetTicks();
+			if(cur_ms-prev_ms < 1000/FPS_MENU){
+				SDL_Delay(1000/FPS_MENU - (cur_ms-prev_ms));
+			}
 		}
 		prev_ms = SDL_GetTicks();
 
@@ -1094,6 +1259,9 @@ int FunkeyMenu::launch( )
 		screen_refresh = 0;
 	}
 
+	/// ------ Store the volume once, not on every step -------
+	store_volume();
+
 	/// ------ Reset prev key repeat params -------
 	if(SDL_EnableKeyRepeat(backup_key_repeat_delay, backup_key_repeat_interval)){
 		MENU_ERROR_PRINTF("ERROR with SDL_EnableKeyRepeat: %s\n", SDL_GetError());
@@ -5,6 +5,8 @@
 #include <SDL/SDL_image.h>
 #include "gmenu2x.h"
 
+class Mixer;
+
 typedef enum{
     MENU_TYPE_VOLUME,
     MENU_TYPE_BRIGHTNESS,
@@ -103,11 +105,17 @@ public:
 
 private:
     static bool executeRawPath(const char *shellCmd);
+    static int parse_system_value(const char *shellCmd, int status, std::string const& res);
+    static void set_volume(int percentage);
+    static void store_volume();
+    static void set_brightness(int percentage);
     static void draw_progress_bar(SDL_Surface * surface, uint16_t x, uint16_t y, uint16_t width,
             uint16_t height, uint8_t percentage, uint16_t nb_bars);
     static void add_menu_zone(ENUM_MENU_TYPE menu_type);
+    static SDL_Surface *get_menu_zone(int idx);
     static void init_menu_zones();
-    static void init_menu_system_values();
+    static void request_menu_system_values();
+    static bool apply_menu_system_values();
     static void menu_screen_refresh(int menuItem, int prevItem, int scroll, uint8_t menu_confirmation, uint8_t menu_action);
 
     //static SDL_Surface * hw_screen;
@@ -148,5 +156,6 @@ private:
     static int savestate_slot;
 
     static GMenu2X *gmenu2x_ptr;
+    static Mixer *mixer;
     static int indexChooseLayout;
 };
@@ -18,8 +18,10 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include "animation.h"
 #include "background.h"
 #include "brightnessmanager.h"
+#include "commandrunner.h"
 #include "buildopts.h"
 #include "cpu.h"
 #include "debug.h"
@@ -32,6 +34,7 @@
 #include "helppopup.h"
 #include "iconbutton.h"
 #include "inputdialog.h"
+#include "latency.h"
 #include "launcher.h"
 #include "linkapp.h"
 #include "mediamonitor.h"
@@ -46,6 +49,8 @@
 #include "menusettingstring.h"
 #include "messagebox.h"
 #include "powersaver.h"
+#include "searchdialog.h"
+#include "searchindex.h"
 #include "settingsdialog.h"
 #include "textdialog.h"
 #include "wallpaperdialog.h"
@@ -142,6 +147,7 @@ static void quick_poweroff()
     }
 
     /* Perform Instant Play save and shutdown */
+    logFlush();
     execlp(SHELL_CMD_POWERDOWN, SHELL_CMD_POWERDOWN);
 
     /* Should not be reached */
@@ -152,9 +158,12 @@ static void quick_poweroff()
 }
 
 /* Handler for SIGUSR1, caused by closing the console */
-static void handle_sigusr1(int sig)
+static void handle_sigusr1(int /*sig*/)
 {
-    printf("Caught signal USR1 %d\n", sig);
+    static const char msg[] = "Caught signal USR1\n";
+    if (write(STDOUT_FILENO, msg, sizeof(msg) - 1) < 0) {
+        /* Nothing to do about it */
+    }
 
     /* Exit menu if it was launched */
     FunkeyMenu::stop();
@@ -168,6 +177,13 @@ const string GMenu2X::getHome()
 	return gmenu2x_home;
 }
 
+/* Prints how much pixel memory the surfaces hold, and the input latency */
+static void handle_sigusr2(int /*sig*/)
+{
+	SurfaceMemory::writeReport(STDOUT_FILENO);
+	InputLatency::writeReport(STDOUT_FILENO);
+}
+
 static void set_handler(int signal, void (*handler)(int))
 {
 	struct sigaction sig;
@@ -178,20 +194,16 @@ static void set_handler(int signal, void (*handler)(int))
 }
 
 int main(int /*argc*/, char * /*argv*/[]) {
-	FILE *fp;
-
 	INFO("---- GMenu2X starting ----\n");
 
 	set_handler(SIGINT, &quit_all);
 	set_handler(SIGSEGV, &quit_all);
 	set_handler(SIGTERM, &quit_all);
 	set_handler(SIGUSR1, &handle_sigusr1);
+	set_handler(SIGUSR2, &handle_sigusr2);
 
 	/* Stop Ampli */
-	fp = popen(SHELL_CMD_AUDIO_AMP_OFF, "r");
-	if (fp != NULL) {
-		pclose(fp);
-	}
+	CommandRunner::set("audio_amp", SHELL_CMD_AUDIO_AMP_OFF);
 
 	char *home = getenv("HOME");
 	if (home == NULL) {
@@ -260,6 +272,7 @@ GMenu2X::GMenu2X() : input(*this), sc(this)
 	/* We enable video at a later stage, so that the menu elements are
 	 * loaded before SDL inits the video; this is made so that we won't show
 	 * a black screen for a couple of seconds. */
+	OutputSurface::selectBackend();
 	if( SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
 		ERROR("Could not initialize SDL: %s\n", SDL_GetError());
 		// TODO: We don't use exceptions, so don't put things that can fail
@@ -290,6 +303,21 @@ GMenu2X::GMenu2X() : input(*this), sc(this)
 	//load config data
 	readConfig();
 
+#if !defined(G2X_BUILD_OPTION_SCREEN_DEPTH)
+	// The screen was opened at its native depth. A lower configured depth,
+	// such as 16-bit RGB565, halves the bandwidth of every fill and blit:
+	// backgrounds and pages follow the display format.
+	if (confInt["videoBpp"] < s->getSurface()->format->BitsPerPixel) {
+		auto screen = OutputSurface::open(width(), height(), confInt["videoBpp"]);
+		if (screen) {
+			s = move(screen);
+			DEBUG("Switched to %d bpp\n", confInt["videoBpp"]);
+		} else {
+			WARNING("Unable to switch to %d bpp\n", confInt["videoBpp"]);
+		}
+	}
+#endif
+
 	brightnessmanager = std::make_unique<BrightnessManager>(this);
 	confInt["brightnessLevel"] = brightnessmanager->currentBrightness();
 
@@ -316,8 +344,13 @@ GMenu2X::GMenu2X() : input(*this), sc(this)
 
 	initMenu();
 
+	// Filled on the first search, since that reads the links of every
+	// section; until then, queries use the index saved by the last session.
+	searchIndex.reset(new SearchIndex(getHome() + "/search.idx"));
+
 #ifdef ENABLE_INOTIFY
-	monitor = new MediaMonitor(GMENU2X_CARD_ROOT, menu.get());
+	monitor = new MediaMonitor(GMENU2X_CARD_ROOT, menu->getMonitorQueue());
+	monitor->start();
 #endif
 
 	if (!input.init(menu.get())) {
@@ -328,7 +361,7 @@ GMenu2X::GMenu2X() : input(*this), sc(this)
     FunkeyMenu::init( *this );
 	
 	// Turn audio amp off to avoid buzzing sound
-	system(SHELL_CMD_AUDIO_AMP_OFF);
+	CommandRunner::set("audio_amp", SHELL_CMD_AUDIO_AMP_OFF);
 
 	//powerSaver->setScreenTimeout(confInt["backlightTimeout"]);
 }
@@ -351,15 +384,18 @@ void GMenu2X::initBG() {
 	bgmain.reset();
 
 	// Load wallpaper.
-	bg = OffscreenSurface::loadImage(confStr["wallpaper"]);
+	bg = OffscreenSurface::loadImage(
+			confStr["wallpaper"], false, width(), height());
 	if (!bg) {
 		bg = OffscreenSurface::emptySurface(width(), height());
 	}
+	bg->setUse(SurfaceUse::BACKGROUND);
 
 	drawTopBar(*bg);
 	drawBottomBar(*bg);
 
 	bgmain.reset(new OffscreenSurface(*bg));
+	bgmain->setUse(SurfaceUse::BACKGROUND);
 
 	{
 		auto sd = OffscreenSurface::loadImage(
@@ -406,6 +442,11 @@ void GMenu2X::initBG() {
 	(void)serviceX;
 
 	bgmain->convertToDisplayFormat();
+
+	Dialog::clearChromeCache();
+	if (menu) {
+		menu->invalidatePages();
+	}
 }
 
 bool GMenu2X::initFont() {
@@ -431,6 +472,10 @@ void GMenu2X::initMenu() {
 			bind(&GMenu2X::explorer, this),
 			tr["Launch an application"],
 			"skin:icons/explorer.png");
+	menu->addActionLink(appIdx, tr["Search"],
+			bind(&GMenu2X::search, this),
+			tr["Find an application or a file to launch"],
+			"skin:icons/explorer.png");
 
 	// Add action links in the settings section.
 	auto settingIdx = menu->sectionNamed("settings");
@@ -458,7 +503,6 @@ void GMenu2X::initMenu() {
 			"skin:icons/about.png");
 
 	menu->skinUpdated();
-	menu->orderLinks();
 
 	menu->setSectionIndex(confInt["section"]);
 	menu->setLinkIndex(confInt["link"]);
@@ -642,6 +686,7 @@ void GMenu2X::mainLoop() {
 		}
 
 		// Run animations.
+		AnimationScheduler::beginFrame();
 		bool animating = false;
 		for (auto layer : layers) {
 			animating |= layer->runAnimations();
@@ -658,19 +703,35 @@ void GMenu2X::mainLoop() {
 			break;
 		}
 
-		// Handle other input events.
+		// Use the idle time to get the next sections ready.
+		if (!animating) {
+			menu->renderAdjacentPages();
+		}
+
+		// Handle other input events. While animating, sleep until the next
+		// frame is due instead of spinning; otherwise sleep until an event.
 		InputManager::Button button;
 		bool gotEvent;
-		const bool wait = !animating;
-		do {
-			gotEvent = input.getButton(&button, wait);
-		} while (wait && !gotEvent);
+		if (animating) {
+			gotEvent = input.getButton(&button, false);
+			if (!gotEvent) {
+				AnimationScheduler::waitForNextFrame();
+			}
+		} else {
+			do {
+				gotEvent = input.getButton(&button, true);
+			} while (!gotEvent);
+		}
 		if (gotEvent) {
 
 			/** Global button mapping: HOME */
 			if (button == InputManager::HOME) {
 				printf("Launch FunKey menu\n");
+				// The FunKey menu reads SDL events itself, including the
+				// releases of keys pressed before or during it.
+				input.syncHeldKeys();
 				int res = FunkeyMenu::launch();
+				input.syncHeldKeys();
 				if (res == MENU_RETURN_EXIT) {
 					button = InputManager::QUIT;
 				}
@@ -702,6 +763,8 @@ void GMenu2X::mainLoop() {
 
 			/** Check button Mapping by layer instances */
 			for (auto it = layers.rbegin(); it != layers.rend(); ++it) {
+				// Dialogs opened by the layer set a context of their own.
+				InputLatency::setContext((*it)->getName());
 				if ((*it)->handleButtonPress(button)) {
 					break;
 				}
@@ -724,6 +787,63 @@ void GMenu2X::explorer() {
 	}
 }
 
+/**
+ * Returns the key under which the given link is known to the search index.
+ * An OPK can contain several applications, so the metadata file is part
+ * of the key.
+ */
+static string searchKey(LinkApp& link) {
+#ifdef HAVE_LIBOPK
+	if (link.isOpk()) {
+		return link.getOpkFile() + '#' + link.getMetadata();
+	}
+#endif
+	return link.getFile();
+}
+
+void GMenu2X::updateSearchIndex() {
+	vector<SearchIndex::Source> sources;
+	for (size_t i = 0; i < menu->getSections().size(); i++) {
+		for (auto& link : *menu->sectionLinks(i)) {
+			LinkApp *app = dynamic_cast<LinkApp *>(link.get());
+			if (!app) continue;
+
+			sources.push_back({
+				searchKey(*app), app->getTitle(),
+				app->getSelectorDir(), app->getSelectorFilter(),
+				app->getSelectorBrowser(),
+			});
+		}
+	}
+	searchIndex->setSources(move(sources));
+}
+
+void GMenu2X::search() {
+	// Links may have been added, edited or removed since the last search.
+	updateSearchIndex();
+
+	SearchDialog sd(*this, *searchIndex);
+	if (!sd.exec()) {
+		return;
+	}
+
+	auto const& result = sd.getResult();
+	for (size_t i = 0; i < menu->getSections().size(); i++) {
+		for (auto& link : *menu->sectionLinks(i)) {
+			LinkApp *app = dynamic_cast<LinkApp *>(link.get());
+			if (!app || searchKey(*app) != result.key) continue;
+
+			if (result.dir.empty()) {
+				app->run();
+			} else {
+				app->launch(result.dir, result.name);
+			}
+			return;
+		}
+	}
+	WARNING("Search result '%s' no longer has a link\n", result.name.c_str());
+}
+
 void GMenu2X::queueLaunch(
 	unique_ptr<Launcher>&& launcher, shared_ptr<Layer> launchLayer
 ) {
@@ -793,6 +913,8 @@ void GMenu2X::showSettings() {
 		if (lang != tr.lang()) {
 			tr.setLang(lang);
 			confStr["lang"] = lang;
+			// The cached chrome holds translated button labels.
+			Dialog::clearChromeCache();
 		}
 
 		writeConfig();
@@ -1035,6 +1157,7 @@ void GMenu2X::editLink() {
 		linkApp->setClock(cpu.freqFromStr(freq));
 #endif
 		linkApp->save();
+		menu->invalidatePages();
 
 		if (oldSection != newSection) {
 			INFO("Changed section: '%s' -> '%s'\n",
@@ -45,6 +45,7 @@ class Launcher;
 class Layer;
 class MediaMonitor;
 class Menu;
+class SearchIndex;
 
 const int LOOP_DELAY = 30000;
 
@@ -69,6 +70,7 @@ private:
 	MediaMonitor *monitor;
 #endif
 	std::unique_ptr<BrightnessManager> brightnessmanager;
+	std::unique_ptr<SearchIndex> searchIndex;
 
 	std::unique_ptr<Launcher> toLaunch;
 
@@ -85,6 +87,11 @@ private:
 	*/
 	void explorer();
 
+	/*!
+	Hands the current set of links to the search index
+	*/
+	void updateSearchIndex();
+
 	bool inet, //!< Represents the configuration of the basic network services. @see readCommonIni @see usbnet @see samba @see web
 		usbnet,
 		samba,
@@ -147,6 +154,9 @@ public:
 		return std::make_pair(top, s->height() - top - bottom);
 	}
 
+	/** Returns the sysfs backlight control; check available() before use. */
+	BrightnessManager *getBrightnessManager() { return brightnessmanager.get(); }
+
 	//std::shared_ptr<PowerSaver> powerSaver;
 	InputManager input;
 #ifdef ENABLE_CPUFREQ
@@ -182,6 +192,7 @@ public:
 	void about();
 	void viewLog();
 	void changeWallpaper();
+	void search();
 
 	/**
 	 * Requests that the given application be launched.
@@ -19,6 +19,7 @@ public:
 	// Layer implementation:
 	virtual void paint(Surface& s);
 	virtual bool handleButtonPress(InputManager::Button button);
+	virtual const char *getName() { return "help popup"; }
 
 private:
 	GMenu2X& gmenu2x;
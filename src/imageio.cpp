@@ -10,11 +10,14 @@
 
 #include <SDL.h>
 #include <png.h>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 #ifdef HAVE_LIBOPK
-#include <opk.h>
+#include "opkpool.h"
 
 static void __readFromOpk(png_structp png_ptr, png_bytep ptr, png_size_t length)
 {
@@ -25,19 +28,203 @@ static void __readFromOpk(png_structp png_ptr, png_bytep ptr, png_size_t length)
 }
 #endif
 
-SDL_Surface *loadPNG(const std::string &path, bool loadAlpha) {
+/** 4x4 Bayer matrix, for ordered dithering. */
+static const uint8_t bayer4x4[4][4] = {
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 },
+};
+
+/**
+ * Returns true iff rows of the given format can be written by convertRow().
+ * Other formats (paletted, 24bpp) are converted by SDL after decoding.
+ */
+static bool canConvertRows(const SDL_PixelFormat *format) {
+	return !format->palette
+		&& (format->BytesPerPixel == 2 || format->BytesPerPixel == 4);
+}
+
+/**
+ * Converts one decoded row from ARGB to the pixel format of 'surface'.
+ */
+static void convertRow(const uint32_t *src, SDL_Surface *surface,
+		unsigned int y, unsigned int flags) {
+	const SDL_PixelFormat *fmt = surface->format;
+	const bool dither = (flags & PNG_DITHER)
+			&& (fmt->Rloss | fmt->Gloss | fmt->Bloss);
+	const uint8_t *threshold = bayer4x4[y & 3];
+	uint8_t *dst = static_cast<uint8_t *>(surface->pixels) + y * surface->pitch;
+
+	for (int x = 0; x < surface->w; x++) {
+		uint32_t argb = src[x];
+		uint32_t a = argb >> 24;
+		uint32_t r = (argb >> 16) & 0xFF;
+		uint32_t g = (argb >> 8) & 0xFF;
+		uint32_t b = argb & 0xFF;
+
+		if (dither) {
+			// Add a fraction of one output step, so rounding errors even out
+			// over a 4x4 block instead of forming bands.
+			uint32_t d = threshold[x & 3];
+			r = std::min(r + ((d << fmt->Rloss) >> 4), 255u);
+			g = std::min(g + ((d << fmt->Gloss) >> 4), 255u);
+			b = std::min(b + ((d << fmt->Bloss) >> 4), 255u);
+		}
+
+		uint32_t pixel = (r >> fmt->Rloss) << fmt->Rshift
+				| (g >> fmt->Gloss) << fmt->Gshift
+				| (b >> fmt->Bloss) << fmt->Bshift;
+		if (fmt->Amask) {
+			pixel |= (a >> fmt->Aloss) << fmt->Ashift;
+		}
+
+		if (fmt->BytesPerPixel == 2) {
+			reinterpret_cast<uint16_t *>(dst)[x] = pixel;
+		} else {
+			reinterpret_cast<uint32_t *>(dst)[x] = pixel;
+		}
+	}
+}
+
+bool readPNGSize(const std::string &path,
+		unsigned int &width, unsigned int &height) {
+	// The IHDR chunk always comes first, right after the signature.
+	png_byte header[24];
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp) return false;
+	const bool ok = fread(header, 1, sizeof(header), fp) == sizeof(header)
+			&& !png_sig_cmp(header, 0, 8)
+			&& !memcmp(header + 12, "IHDR", 4);
+	fclose(fp);
+	if (!ok) return false;
+
+	width = png_get_uint_32(header + 16);
+	height = png_get_uint_32(header + 20);
+	return true;
+}
+
+/**
+ * Shrinks an image by averaging boxes of source pixels. Source rows are
+ * consumed as they are decoded, so only a few rows are held in memory.
+ * Each row is first reduced horizontally, then accumulated vertically.
+ */
+class BoxScaler {
+public:
+	BoxScaler(unsigned int srcWidth, unsigned int srcHeight,
+			unsigned int dstWidth, unsigned int dstHeight)
+		: srcHeight(srcHeight), dstWidth(dstWidth), dstHeight(dstHeight)
+		, srcY(0), dstY(0), boxRows(0)
+		, columns(dstWidth + 1), sums(dstWidth * 4), out(dstWidth)
+	{
+		for (unsigned int x = 0; x <= dstWidth; x++) {
+			columns[x] = (uint64_t)x * srcWidth / dstWidth;
+		}
+	}
+
+	/**
+	 * Adds the next source row.
+	 * @return The next output row, or NULL if more source rows are needed.
+	 */
+	const uint32_t *addRow(const uint32_t *src) {
+		for (unsigned int x = 0; x < dstWidth; x++) {
+			uint32_t a = 0, r = 0, g = 0, b = 0;
+			for (unsigned int i = columns[x]; i < columns[x + 1]; i++) {
+				a += src[i] >> 24;
+				r += (src[i] >> 16) & 0xFF;
+				g += (src[i] >> 8) & 0xFF;
+				b += src[i] & 0xFF;
+			}
+			const uint32_t n = columns[x + 1] - columns[x];
+			sums[x * 4 + 0] += (a + n / 2) / n;
+			sums[x * 4 + 1] += (r + n / 2) / n;
+			sums[x * 4 + 2] += (g + n / 2) / n;
+			sums[x * 4 + 3] += (b + n / 2) / n;
+		}
+		boxRows++;
+
+		if (++srcY < (uint64_t)(dstY + 1) * srcHeight / dstHeight) {
+			return NULL;
+		}
+
+		for (unsigned int x = 0; x < dstWidth; x++) {
+			uint32_t *sum = &sums[x * 4];
+			out[x] = (sum[0] + boxRows / 2) / boxRows << 24
+				| (sum[1] + boxRows / 2) / boxRows << 16
+				| (sum[2] + boxRows / 2) / boxRows << 8
+				| (sum[3] + boxRows / 2) / boxRows;
+		}
+		std::fill(sums.begin(), sums.end(), 0);
+		boxRows = 0;
+		dstY++;
+		return out.data();
+	}
+
+	/** Returns the index of the output row last returned by addRow(). */
+	unsigned int lastRow() const { return dstY - 1; }
+
+private:
+	const unsigned int srcHeight, dstWidth, dstHeight;
+	unsigned int srcY, dstY, boxRows;
+	std::vector<unsigned int> columns;
+	std::vector<uint32_t> sums, out;
+};
+
+/**
+ * Everything decodePNG() acquires while decoding. A libpng error longjmps
+ * back to decodePNG(), skipping destructors and leaving modified locals
+ * undefined, so all of it is kept on the heap and released in one place.
+ */
+struct PNGDecodeState {
+	/** One per region; on success, handed over to the caller. */
+	std::vector<SDL_Surface *> surfaces;
+	FILE *fp = NULL;
+#ifdef HAVE_LIBOPK
+	void *buffer = NULL, *param = NULL;
+#endif
+	std::vector<std::unique_ptr<BoxScaler>> scalers;
+	std::unique_ptr<uint32_t[]> image, row;
+	std::unique_ptr<png_bytep[]> rowPointers;
+
+	~PNGDecodeState() {
+		for (SDL_Surface *surface : surfaces) {
+			if (surface) SDL_FreeSurface(surface);
+		}
+		if (fp) fclose(fp);
+#ifdef HAVE_LIBOPK
+		free(buffer);
+#endif
+	}
+};
+
+/**
+ * Decodes a PNG file once, loading each of the given regions into its own
+ * surface, or the whole image if 'regions' is NULL and 'count' is 1.
+ * On failure, all of 'surfaces' are NULL.
+ */
+static bool decodePNG(const std::string &path, bool loadAlpha,
+		const SDL_PixelFormat *format, unsigned int flags,
+		unsigned int maxWidth, unsigned int maxHeight,
+		const PNGRegion *regions, size_t count, SDL_Surface **surfaces) {
 	// Declare these with function scope and initialize them to NULL,
 	// so we can use a single cleanup block at the end of the function.
-	SDL_Surface *surface = NULL;
-	FILE *fp = NULL;
+	// Only 'state' is used after an error, and it is not modified after
+	// setjmp(); what it points to is.
+	bool ok = false;
+	PNGDecodeState *const state = new PNGDecodeState;
 	png_structp png = NULL;
 	png_infop info = NULL;
+	const SDL_PixelFormat *rowFormat;
+	png_uint_32 lastRow;
+	int passes;
 #ifdef HAVE_LIBOPK
 	std::string::size_type pos;
-	struct OPK *opk = NULL;
-	void *buffer = NULL, *param;
 #endif
 
+	std::fill(surfaces, surfaces + count, nullptr);
+	state->surfaces.resize(count, nullptr);
+	state->scalers.resize(count);
+
 	// Create and initialize the top-level libpng struct.
 	png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (!png) goto cleanup;
@@ -47,10 +234,6 @@ SDL_Surface *loadPNG(const std::string &path, bool loadAlpha) {
 	// Setup error handling for errors detected by libpng.
 	if (setjmp(png_jmpbuf(png))) {
 		// Note: This gets executed when an error occurs.
-		if (surface) {
-			SDL_FreeSurface(surface);
-			surface = NULL;
-		}
 		goto cleanup;
 	}
 
@@ -62,31 +245,26 @@ SDL_Surface *loadPNG(const std::string &path, bool loadAlpha) {
 
 		DEBUG("Registering specific callback for icon %s\n", path.c_str());
 
-		opk = opk_open(path.substr(0, pos).c_str());
-		if (!opk) {
-			ERROR("Unable to open OPK\n");
-			goto cleanup;
-		}
-
-		ret = opk_extract_file(opk, path.substr(pos + 1).c_str(),
-					&buffer, &length);
+		// Icons are kept in memory since the package was scanned.
+		ret = OpkPool::readFile(path.substr(0, pos), path.substr(pos + 1),
+					&state->buffer, &length);
 		if (ret < 0) {
 			ERROR("Unable to extract icon from OPK\n");
 			goto cleanup;
 		}
 
-		param = buffer;
+		state->param = state->buffer;
 
-		png_set_read_fn(png, &param, __readFromOpk);
+		png_set_read_fn(png, &state->param, __readFromOpk);
 	} else {
 #else
 	if (1) {
 #endif /* HAVE_LIBOPK */
-		fp = fopen(path.c_str(), "rb");
-		if (!fp) goto cleanup;
+		state->fp = fopen(path.c_str(), "rb");
+		if (!state->fp) goto cleanup;
 
 		// Set up the input control if you are using standard C streams.
-		png_init_io(png, fp);
+		png_init_io(png, state->fp);
 	}
 
 	// The call to png_read_info() gives us all of the information from the
@@ -118,6 +296,9 @@ SDL_Surface *loadPNG(const std::string &path, bool loadAlpha) {
 		png_set_bgr(png); // BGRA in memory becomes ARGB in register
 	}
 
+	// Let libpng combine the passes of interlaced images.
+	passes = png_set_interlace_handling(png);
+
 	// Update the image info to the post-conversion state.
 	png_read_update_info(png, info);
 	png_get_IHDR(
@@ -135,45 +316,242 @@ SDL_Surface *loadPNG(const std::string &path, bool loadAlpha) {
 		goto cleanup;
 	}
 
-	// Allocate [A]RGB surface to hold the image.
-	surface = SDL_CreateRGBSurface(
-		SDL_SWSURFACE | SDL_SRCALPHA, width, height, 32,
-		0x00FF0000, 0x0000FF00, 0x000000FF, loadAlpha ? 0xFF000000 : 0x00000000
-		);
-	if (!surface) {
-		// Failed to create surface, probably out of memory.
-		goto cleanup;
+	// Paletted and 24bpp targets are left to SDL_ConvertSurface.
+	rowFormat = format && canConvertRows(format) ? format : NULL;
+
+	lastRow = 0;
+	for (size_t i = 0; i < count; i++) {
+		PNGRegion area = { 0, 0, width, height };
+		if (regions) {
+			const PNGRegion &region = regions[i];
+			if (!region.w || !region.h || region.x >= width
+					|| region.y >= height || region.w > width - region.x
+					|| region.h > height - region.y) {
+				WARNING("Requested region is outside of image\n");
+				goto cleanup;
+			}
+			area = region;
+		}
+		lastRow = std::max(lastRow, area.y + area.h);
+
+		// Shrink the image to fit in the requested size, keeping its aspect.
+		png_uint_32 outWidth = area.w;
+		png_uint_32 outHeight = area.h;
+		if (maxWidth && outWidth > maxWidth) {
+			outHeight = std::max<png_uint_32>(
+					(uint64_t)outHeight * maxWidth / outWidth, 1);
+			outWidth = maxWidth;
+		}
+		if (maxHeight && outHeight > maxHeight) {
+			outWidth = std::max<png_uint_32>(
+					(uint64_t)outWidth * maxHeight / outHeight, 1);
+			outHeight = maxHeight;
+		}
+		if (outWidth != area.w || outHeight != area.h) {
+			state->scalers[i].reset(
+					new BoxScaler(area.w, area.h, outWidth, outHeight));
+		}
+
+		SDL_Surface *surface;
+		if (rowFormat) {
+			// Allocate a surface in the requested format; only keep its
+			// alpha channel if the caller wants alpha.
+			const Uint32 amask = loadAlpha ? rowFormat->Amask : 0;
+			surface = SDL_CreateRGBSurface(
+				SDL_SWSURFACE | (amask ? SDL_SRCALPHA : 0),
+				outWidth, outHeight, rowFormat->BitsPerPixel,
+				rowFormat->Rmask, rowFormat->Gmask, rowFormat->Bmask, amask);
+		} else {
+			// Allocate [A]RGB surface to hold the image.
+			surface = SDL_CreateRGBSurface(
+				SDL_SWSURFACE | SDL_SRCALPHA, outWidth, outHeight, 32,
+				0x00FF0000, 0x0000FF00, 0x000000FF,
+				loadAlpha ? 0xFF000000 : 0x00000000
+				);
+		}
+		if (!surface) {
+			// Failed to create surface, probably out of memory.
+			goto cleanup;
+		}
+		state->surfaces[i] = surface;
 	}
 
-	// Note: GCC 4.9 doesn't want to jump over 'rowPointers' with goto
-	//       if it is in the outer scope.
+	// Note: GCC 4.9 doesn't want to jump over initialized locals with goto
+	//       if they are in the outer scope.
 	{
-		// Compute row pointers.
-		auto rowPointers = std::make_unique<png_bytep[]>(height);
+		std::unique_ptr<uint32_t[]> &image = state->image, &row = state->row;
+		// Without cropping, scaling or conversion, rows are decoded into
+		// the surface.
+		SDL_Surface *whole = state->surfaces[0];
+		const bool direct = !regions && !state->scalers[0] && !rowFormat;
+		auto surfaceRow = [whole](png_uint_32 y) {
+			return reinterpret_cast<uint32_t *>(
+				static_cast<uint8_t *>(whole->pixels) + y * whole->pitch);
+		};
 
-		for (png_uint_32 y = 0; y < height; y++) {
-			rowPointers[y] =
-				static_cast<png_bytep>(surface->pixels) + y * surface->pitch;
+		// Rows of an interlaced image are only complete after the last pass,
+		// so those have to be decoded in full; other images are decoded one
+		// row at a time into a scratch row.
+		if (passes > 1) {
+			if (!direct) {
+				image = std::make_unique<uint32_t[]>((size_t)width * height);
+			}
+
+			// Compute row pointers.
+			state->rowPointers = std::make_unique<png_bytep[]>(height);
+
+			for (png_uint_32 y = 0; y < height; y++) {
+				state->rowPointers[y] = reinterpret_cast<png_bytep>(direct
+						? surfaceRow(y) : image.get() + (size_t)y * width);
+			}
+
+			// Read the entire image in one go.
+			png_read_image(png, state->rowPointers.get());
+		} else if (!direct) {
+			row = std::make_unique<uint32_t[]>(width);
 		}
 
-		// Read the entire image in one go.
-		png_read_image(png, rowPointers.get());
+		for (png_uint_32 y = 0; y < lastRow; y++) {
+			uint32_t *decoded = image ? image.get() + (size_t)y * width
+					: row ? row.get() : surfaceRow(y);
+			if (passes == 1) {
+				png_read_row(png, reinterpret_cast<png_bytep>(decoded), NULL);
+			}
+			if (direct) continue;
+
+			// Every region crops its own columns out of the same row.
+			for (size_t i = 0; i < count; i++) {
+				const PNGRegion area = regions
+						? regions[i] : PNGRegion { 0, 0, width, height };
+				if (y < area.y || y >= area.y + area.h) continue;
+
+				const uint32_t *src = decoded + area.x;
+				png_uint_32 outY = y - area.y;
+				if (auto &scaler = state->scalers[i]) {
+					src = scaler->addRow(src);
+					if (!src) continue;
+					outY = scaler->lastRow();
+				}
+				convertRow(src, state->surfaces[i], outY, flags);
+			}
+		}
 	}
 
 	// Read rest of file, and get additional chunks in the info struct.
 	// Note: We got all we need, so skip this step.
 	//png_read_end(png, info);
 
+	// libpng is done, so nothing can longjmp past 'surfaces' anymore.
+	for (size_t i = 0; i < count; i++) {
+		if (format && !rowFormat) {
+			surfaces[i] = SDL_ConvertSurface(state->surfaces[i],
+					const_cast<SDL_PixelFormat *>(format), SDL_SWSURFACE);
+		} else {
+			surfaces[i] = state->surfaces[i];
+			state->surfaces[i] = NULL;
+		}
+	}
+	ok = true;
+
 cleanup:
 	// Clean up.
 	png_destroy_read_struct(&png, &info, NULL);
-	if (fp) fclose(fp);
-#ifdef HAVE_LIBOPK
-	if (buffer)
-		free(buffer);
-	if (opk)
-		opk_close(opk);
-#endif
+	delete state;
 
+	return ok;
+}
+
+SDL_Surface *loadPNG(const std::string &path, bool loadAlpha,
+		const SDL_PixelFormat *format, unsigned int flags,
+		unsigned int maxWidth, unsigned int maxHeight,
+		const PNGRegion *region) {
+	SDL_Surface *surface;
+	decodePNG(path, loadAlpha, format, flags, maxWidth, maxHeight,
+			region, 1, &surface);
 	return surface;
 }
+
+bool loadPNGRegions(const std::string &path, bool loadAlpha,
+		const PNGRegion *regions, size_t count, SDL_Surface **surfaces) {
+	return decodePNG(path, loadAlpha, NULL, 0, 0, 0,
+			regions, count, surfaces);
+}
+
+/** Returns the pixel at the given position, in the surface's own format. */
+static Uint32 getPixel(const SDL_Surface *surface, int x, int y) {
+	const Uint8 *p = static_cast<const Uint8 *>(surface->pixels)
+			+ y * surface->pitch + x * surface->format->BytesPerPixel;
+	switch (surface->format->BytesPerPixel) {
+	case 1:
+		return *p;
+	case 2:
+		return *reinterpret_cast<const Uint16 *>(p);
+	case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		return p[0] << 16 | p[1] << 8 | p[2];
+#else
+		return p[0] | p[1] << 8 | p[2] << 16;
+#endif
+	default:
+		return *reinterpret_cast<const Uint32 *>(p);
+	}
+}
+
+bool savePNG(SDL_Surface *surface, const std::string &path) {
+	FILE *fp = fopen(path.c_str(), "wb");
+	if (!fp) {
+		ERROR("Unable to create '%s'\n", path.c_str());
+		return false;
+	}
+
+	std::vector<png_byte> row(surface->w * 3);
+	// Modified after setjmp() and read after an error.
+	volatile bool ok = false;
+	volatile bool locked = false;
+
+	png_structp png = png_create_write_struct(
+			PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if (!info) {
+		goto cleanup;
+	}
+	if (setjmp(png_jmpbuf(png))) {
+		ERROR("Error writing PNG file '%s'\n", path.c_str());
+		goto cleanup;
+	}
+
+	png_init_io(png, fp);
+	png_set_IHDR(png, info, surface->w, surface->h, 8, PNG_COLOR_TYPE_RGB,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+			PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+
+	if (SDL_MUSTLOCK(surface)) {
+		if (SDL_LockSurface(surface) < 0) {
+			goto cleanup;
+		}
+		locked = true;
+	}
+	for (int y = 0; y < surface->h; y++) {
+		for (int x = 0; x < surface->w; x++) {
+			SDL_GetRGB(getPixel(surface, x, y), surface->format,
+					&row[x * 3], &row[x * 3 + 1], &row[x * 3 + 2]);
+		}
+		png_write_row(png, row.data());
+	}
+	if (locked) {
+		SDL_UnlockSurface(surface);
+		locked = false;
+	}
+
+	png_write_end(png, NULL);
+	ok = true;
+
+cleanup:
+	if (locked) {
+		SDL_UnlockSurface(surface);
+	}
+	png_destroy_write_struct(&png, &info);
+	fclose(fp);
+	return ok;
+}
@@ -1,12 +1,56 @@
 #ifndef IMAGEIO_H
 #define IMAGEIO_H
 
+#include <cstddef>
 #include <string>
 
+struct SDL_PixelFormat;
 struct SDL_Surface;
 
-/** Loads an image from a PNG file into a newly allocated 32bpp RGBA surface.
+/** Flags for loadPNG(). */
+enum {
+	/** Dither with a 4x4 ordered pattern when the target format has fewer
+	  * than 8 bits per color channel, such as RGB565. */
+	PNG_DITHER = 1 << 0,
+};
+
+/** A rectangle within an image, in pixels. */
+struct PNGRegion {
+	unsigned int x, y, w, h;
+};
+
+/** Reads the width and height of a PNG file without decoding it.
+  * Returns false if the file could not be read or is not a PNG file.
+  */
+bool readPNGSize(const std::string &path,
+		unsigned int &width, unsigned int &height);
+
+/** Loads an image from a PNG file into a newly allocated surface.
+  * If no format is given, the surface is 32bpp RGBA; otherwise it uses the
+  * given pixel format, and every row is converted as it is decoded, so no
+  * 32bpp copy of the image is made.
+  * If loadAlpha is false, the surface will not have an alpha channel.
+  * If a maximum width and/or height is given, larger images are shrunk to
+  * fit while they are decoded, keeping their aspect ratio.
+  * If a region is given, only that part of the image is loaded; decoding
+  * stops after its last row.
+  */
+SDL_Surface *loadPNG(const std::string &path, bool loadAlpha = true,
+		const SDL_PixelFormat *format = nullptr, unsigned int flags = 0,
+		unsigned int maxWidth = 0, unsigned int maxHeight = 0,
+		const PNGRegion *region = nullptr);
+
+/** Loads several rectangles of a PNG file, decoding the file only once; for
+  * instance neighbouring pages of a manual. Each region is loaded into the
+  * matching element of 'surfaces' as loadPNG() would with that region.
+  * Returns false, leaving all of 'surfaces' NULL, if any region failed.
+  */
+bool loadPNGRegions(const std::string &path, bool loadAlpha,
+		const PNGRegion *regions, size_t count, SDL_Surface **surfaces);
+
+/** Writes a surface, of any pixel format, to a 24bpp RGB PNG file.
+  * Returns false if the file could not be written.
   */
-SDL_Surface *loadPNG(const std::string &path, bool loadAlpha = true);
+bool savePNG(SDL_Surface *surface, const std::string &path);
 
 #endif
@@ -24,6 +24,7 @@
 #include "buttonbox.h"
 #include "gmenu2x.h"
 #include "iconbutton.h"
+#include "latency.h"
 #include "surface.h"
 #include "utilities.h"
 
@@ -143,6 +144,7 @@ void InputDialog::setKeyboard(int kb) {
 }
 
 bool InputDialog::exec() {
+	InputLatency::Context latency("input dialog");
 	SDL_Rect box = {
 		0, 60, 0, static_cast<Uint16>(gmenu2x.font->getLineSpacing() + 4)
 	};
@@ -150,19 +152,20 @@ bool InputDialog::exec() {
 	Uint32 caretTick = 0, curTick;
 	bool caretOn = true;
 
-	OffscreenSurface bg(*gmenu2x.bg);
-	drawTitleIcon(bg, icon, false);
-	writeTitle(bg, title);
-	writeSubTitle(bg, text);
-	buttonbox.paint(bg, 5, gmenu2x.height() - 1);
-	bg.convertToDisplayFormat();
+	const string chromeKey = "input\n" + icon + '\n' + title + '\n' + text;
+	auto drawChrome = [&](Surface& bg) {
+		drawTitleIcon(bg, icon, false);
+		writeTitle(bg, title);
+		writeSubTitle(bg, text);
+		buttonbox.paint(bg, 5, gmenu2x.height() - 1);
+	};
 
 	close = false;
 	ok = true;
 	while (!close) {
 		OutputSurface& s = *gmenu2x.s;
 
-		bg.blit(s, 0, 0);
+		getChrome(chromeKey, drawChrome).blit(s, 0, 0);
 
 		box.w = gmenu2x.font->getTextWidth(input) + 18;
 		box.x = KEY_XOFFSET - box.w / 2;
@@ -20,11 +20,17 @@
 
 #include "debug.h"
 #include "inputmanager.h"
+#include "inputscript.h"
 #include "gmenu2x.h"
+#include "latency.h"
 #include "utilities.h"
 #include "powersaver.h"
+#include "reactor.h"
 #include "menu.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <fstream>
 
@@ -35,6 +41,7 @@ bool InputManager::init(Menu *menu)
 	this->menu = menu;
 
 	repeatRateChanged();
+	InputLatency::init();
 
 	for (auto& button : buttonMap) {
 		button.js_mapped = false;
@@ -54,6 +61,24 @@ bool InputManager::init(Menu *menu)
 		}
 	}
 
+	script = InputScript::load();
+
+	return true;
+}
+
+bool InputManager::buttonNamed(const string &name, Button *button) {
+	if (name == "up")            *button = UP;
+	else if (name == "down")     *button = DOWN;
+	else if (name == "left")     *button = LEFT;
+	else if (name == "right")    *button = RIGHT;
+	else if (name == "accept")   *button = ACCEPT;
+	else if (name == "cancel")   *button = CANCEL;
+	else if (name == "altleft")  *button = ALTLEFT;
+	else if (name == "altright") *button = ALTRIGHT;
+	else if (name == "menu")     *button = MENU;
+	else if (name == "settings") *button = SETTINGS;
+	else if (name == "home")     *button = HOME;
+	else return false;
 	return true;
 }
 
@@ -98,18 +123,7 @@ bool InputManager::readConfFile(const string &conffile) {
 			line = trim(line.substr(pos+1));
 
 			Button button;
-			if (name == "up")            button = UP;
-			else if (name == "down")     button = DOWN;
-			else if (name == "left")     button = LEFT;
-			else if (name == "right")    button = RIGHT;
-			else if (name == "accept")   button = ACCEPT;
-			else if (name == "cancel")   button = CANCEL;
-			else if (name == "altleft")  button = ALTLEFT;
-			else if (name == "altright") button = ALTRIGHT;
-			else if (name == "menu")     button = MENU;
-			else if (name == "settings") button = SETTINGS;
-			else if (name == "home") button = HOME;
-			else {
+			if (!buttonNamed(name, &button)) {
 				WARNING("InputManager: Ignoring unknown button name \"%s\"\n",
 						name.c_str());
 				continue;
@@ -171,28 +185,146 @@ bool InputManager::pollButton(Button *button) {
 }
 
 bool InputManager::getButton(Button *button, bool wait) {
-	//TODO: when an event is processed, program a new event
-	//in some time, and when it occurs, do a key repeat
+	if (queue.empty()) {
+		readEvents(wait);
+	}
+	dropStaleRepeats();
+	if (queue.empty()) {
+		return false;
+	}
 
+	*button = takeQueued();
+	return true;
+}
+
+InputManager::Button InputManager::waitForPressedButton(unsigned int *steps) {
+	Button button = waitForPressedButton();
+	int forward = 1;
+	Button opposite = oppositeButton(button);
+	if (opposite == button) {
+		*steps = 1;
+		return button;
+	}
+
+	// Take what piled up behind it meanwhile.
+	readEvents(false);
+	dropStaleRepeats();
+	while (!queue.empty()) {
+		const Button next = queue.front().button;
+		if (next == button) {
+			forward++;
+		} else if (next == opposite) {
+			forward--;
+		} else {
+			break;
+		}
+		takeQueued();
+	}
+
+	if (forward == 0) {
+		*steps = 0;
+		return REPAINT;
+	}
+	*steps = abs(forward);
+	return forward > 0 ? button : opposite;
+}
+
+InputManager::Button InputManager::oppositeButton(Button button) {
+	switch (button) {
+		case UP:       return DOWN;
+		case DOWN:     return UP;
+		case ALTLEFT:  return ALTRIGHT;
+		case ALTRIGHT: return ALTLEFT;
+		default:       return button;
+	}
+}
+
+void InputManager::readEvents(bool wait) {
 #ifndef SDL_JOYSTICK_DISABLED
 	if (joysticks.size() > 0)
 		SDL_JoystickUpdate();
 #endif
 
+	// SDL 1.2 events carry no time, so they are stamped when read.
 	SDL_Event event;
-	if (wait)
-		SDL_WaitEvent(&event);
-	else if (!SDL_PollEvent(&event))
-		return false;
+	bool got = SDL_PollEvent(&event);
+	if (wait && !got && script) {
+		// Nothing is left to do, so the screen shows the settled state.
+		queue.push_back({ script->next(*gmenu2x.s), SDL_GetTicks(),
+				true, false });
+		return;
+	}
+	while (wait && !got) {
+		// SDL only repeats held keys while it is pumped.
+		bool repeating = gmenu2x.confInt["buttonRepeatRate"] != 0
+				&& mappedKeyDown();
+		Reactor::instance().waitForEvent(repeating ? INPUT_HELD_KEY_POLL : -1);
+		got = SDL_PollEvent(&event);
+	}
+	const Uint32 now = SDL_GetTicks();
+	while (got) {
+		QueuedButton queued;
+		queued.time = now;
+		if (translateEvent(event, &queued)) {
+			queue.push_back(queued);
+		}
+		got = SDL_PollEvent(&event);
+	}
+}
+
+void InputManager::syncHeldKeys() {
+	const Uint8 *keys = SDL_GetKeyState(nullptr);
+	for (size_t i = 0; i < BUTTON_TYPE_SIZE; i++) {
+		keyHeld[i] = buttonMap[i].kb_mapped && keys[buttonMap[i].kb_code];
+	}
+}
+
+bool InputManager::mappedKeyDown() const {
+	// Unlike keyHeld, this can't miss a release taken by another loop.
+	const Uint8 *keys = SDL_GetKeyState(nullptr);
+	for (size_t i = 0; i < BUTTON_TYPE_SIZE; i++) {
+		if (buttonMap[i].kb_mapped && keys[buttonMap[i].kb_code]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void InputManager::dropStaleRepeats() {
+	const Uint32 now = SDL_GetTicks();
+	while (!queue.empty() && queue.front().repeat
+			&& now - queue.front().time > INPUT_STALE_REPEAT) {
+		queue.pop_front();
+	}
+}
+
+InputManager::Button InputManager::takeQueued() {
+	const QueuedButton queued = queue.front();
+	queue.pop_front();
+	if (queued.button != REPAINT && queued.button != QUIT) {
+		InputLatency::buttonReceived(queued.pressed && !queued.repeat);
+	}
+	return queued.button;
+}
+
+bool InputManager::translateEvent(SDL_Event &event, QueuedButton *queued) {
+	Button *button = &queued->button;
+	queued->repeat = false;
+	queued->pressed = event.type == SDL_KEYDOWN
+			|| event.type == SDL_JOYBUTTONDOWN;
 
 	bool is_kb = false, is_js = false;
 	switch(event.type) {
 		case SDL_KEYDOWN:
+		case SDL_KEYUP:
 			is_kb = true;
 			break;
 #ifndef SDL_JOYSTICK_DISABLED
 		case SDL_JOYHATMOTION: {
 				Joystick *joystick = &joysticks[event.jaxis.which];
+				// The repeat timer sends the same position again.
+				queued->repeat = joystick->timer
+						&& joystick->hatState == event.jhat.value;
 				joystick->hatState = event.jhat.value;
 
 				switch (event.jhat.value) {
@@ -291,28 +423,37 @@ bool InputManager::getButton(Button *button, bool wait) {
 	if (i == BUTTON_TYPE_SIZE)
 		return false;
 
-	if (wait)
-		// PowerSaver::getInstance()->resetScreenTimer();
+	if (is_kb) {
+		// Keys that are already down are repeated by SDL.
+		const bool wasHeld = keyHeld[i];
+		keyHeld[i] = event.type == SDL_KEYDOWN;
+		if (event.type == SDL_KEYUP) {
+			// Repeats still queued would move past where the user let go.
+			const Button released = *button;
+			queue.erase(remove_if(queue.begin(), queue.end(),
+					[released](QueuedButton const& other) {
+						return other.repeat && other.button == released;
+					}), queue.end());
+			return false;
+		}
+		queued->repeat = wasHeld;
+	}
 
 	return true;
 }
 
-Uint32 keyRepeatCallback(Uint32 timeout, void *d)
-{
-	struct Joystick *joystick = (struct Joystick *) d;
-	return joystick->inputManager->joystickRepeatCallback(timeout, joystick);
-}
-
 void InputManager::startTimer(Joystick *joystick)
 {
 	if (joystick->timer)
 		return;
 
-	joystick->timer = SDL_AddTimer(INPUT_KEY_REPEAT_DELAY,
-				keyRepeatCallback, joystick);
+	joystick->timer = make_shared<Reactor::Timer>(
+			bind(&InputManager::joystickRepeat, this, joystick));
+	joystick->timer->start(INPUT_KEY_REPEAT_DELAY,
+			repeatRateMs(gmenu2x.confInt["buttonRepeatRate"]));
 }
 
-Uint32 InputManager::joystickRepeatCallback([[maybe_unused]] Uint32 timeout, struct Joystick *joystick)
+void InputManager::joystickRepeat(struct Joystick *joystick)
 {
 	Uint8 hatState;
 
@@ -334,14 +475,9 @@ Uint32 InputManager::joystickRepeatCallback([[maybe_unused]] Uint32 timeout, str
 		hatState,
 	};
 	SDL_PushEvent((SDL_Event *) &e);
-
-	return repeatRateMs(gmenu2x.confInt["buttonRepeatRate"]);
 }
 
 void InputManager::stopTimer(Joystick *joystick)
 {
-	if (joystick->timer) {
-		SDL_RemoveTimer(joystick->timer);
-		joystick->timer = nullptr;
-	}
+	joystick->timer.reset();
 }
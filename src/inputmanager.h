@@ -21,14 +21,23 @@
 #ifndef INPUTMANAGER_H
 #define INPUTMANAGER_H
 
+#include "reactor.h"
+
 #include <SDL.h>
 #include <string>
 #include <vector>
 #include <array>
+#include <deque>
+#include <memory>
 
 #define INPUT_KEY_REPEAT_DELAY 250
+/** Repeats left unhandled for longer than this (ms) are dropped. */
+#define INPUT_STALE_REPEAT 200
+/** How often SDL is pumped while a key it repeats is held (ms). */
+#define INPUT_HELD_KEY_POLL 10
 
 class GMenu2X;
+class InputScript;
 class Menu;
 class InputManager;
 
@@ -39,7 +48,8 @@ struct Joystick {
 	SDL_Joystick *joystick;
 	bool axisState[2][2];
 	Uint8 hatState;
-	SDL_TimerID timer;
+	/** Repeats the direction held; only exists while one is. */
+	std::shared_ptr<Reactor::Timer> timer;
 	InputManager *inputManager;
 };
 #endif
@@ -62,13 +72,52 @@ public:
 
 	bool init(Menu *menu);
 	Button waitForPressedButton();
+	/**
+	 * Like waitForPressedButton(), but for lists that can't keep up with
+	 * key repeat: UP/DOWN and ALTLEFT/ALTRIGHT presses queued behind the
+	 * button are merged into it. Returns the net direction and sets 'steps'
+	 * to the number of moves; returns REPAINT if they cancel out.
+	 */
+	Button waitForPressedButton(unsigned int *steps);
 	void repeatRateChanged();
-	Uint32 joystickRepeatCallback(Uint32 timeout, struct Joystick *joystick);
+	/**
+	 * Takes which keys are held from SDL. Needed after another event loop
+	 * ran, since it may have consumed the releases of our keys.
+	 */
+	void syncHeldKeys();
+	void joystickRepeat(struct Joystick *joystick);
 	bool pollButton(Button *button);
 	bool getButton(Button *button, bool wait);
 
+	/** Looks up a button by its name in input.conf, e.g. "accept". */
+	static bool buttonNamed(const std::string &name, Button *button);
+
 private:
+	/** A button read from SDL and not handled yet. */
+	struct QueuedButton {
+		Button button;
+		/**
+		 * Time it was read from SDL, in SDL ticks. Repeats that piled up
+		 * in SDL's queue look fresh, so those are dropped when the release
+		 * of their key is read instead.
+		 */
+		Uint32 time;
+		/** Whether it is a key or joystick button going down. */
+		bool pressed;
+		/** Whether it comes from a button held down. */
+		bool repeat;
+	};
+
 	bool readConfFile(const std::string &conffile);
+	/** Moves all the events SDL has into the queue. */
+	void readEvents(bool wait);
+	/** Whether SDL has any key down that is mapped to a button. */
+	bool mappedKeyDown() const;
+	bool translateEvent(SDL_Event &event, QueuedButton *queued);
+	/** Repeats that waited too long would move past where the user let go. */
+	void dropStaleRepeats();
+	Button takeQueued();
+	static Button oppositeButton(Button button);
 
 	struct ButtonMapEntry {
 		bool kb_mapped, js_mapped;
@@ -79,6 +128,10 @@ private:
 	Menu *menu;
 
 	std::array<ButtonMapEntry, BUTTON_TYPE_SIZE> buttonMap;
+	std::array<bool, BUTTON_TYPE_SIZE> keyHeld {};
+	std::deque<QueuedButton> queue;
+	/** Replaces the user when running headless regression tests. */
+	std::unique_ptr<InputScript> script;
 #ifndef SDL_JOYSTICK_DISABLED
 	std::vector<Joystick> joysticks;
 
@@ -0,0 +1,94 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "inputscript.h"
+
+#include "debug.h"
+#include "imageio.h"
+#include "latency.h"
+#include "surface.h"
+#include "utilities.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+
+unique_ptr<InputScript> InputScript::load()
+{
+	const char *path = getenv("GMENU2X_INPUT_SCRIPT");
+	if (!path || !*path) {
+		return nullptr;
+	}
+	const string &dir = OutputSurface::headlessDir();
+	if (dir.empty()) {
+		WARNING("Input scripts need GMENU2X_HEADLESS, ignoring \"%s\"\n", path);
+		return nullptr;
+	}
+
+	ifstream inf(path);
+	if (!inf.is_open()) {
+		ERROR("Unable to open input script \"%s\"\n", path);
+		return nullptr;
+	}
+
+	vector<InputManager::Button> buttons;
+	string line;
+	unsigned int lineNumber = 0;
+	while (getline(inf, line)) {
+		lineNumber++;
+		line = trim(line);
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		InputManager::Button button;
+		if (!InputManager::buttonNamed(line, &button)) {
+			ERROR("%s:%u: unknown button \"%s\"\n",
+					path, lineNumber, line.c_str());
+			return nullptr;
+		}
+		buttons.push_back(button);
+	}
+
+	INFO("Running input script \"%s\" with %zu buttons\n",
+			path, buttons.size());
+	return unique_ptr<InputScript>(new InputScript(dir, move(buttons)));
+}
+
+InputScript::InputScript(string dir, vector<InputManager::Button> buttons)
+	: dir(move(dir))
+	, buttons(move(buttons))
+{
+}
+
+InputManager::Button InputScript::next(OutputSurface& screen)
+{
+	if (step > buttons.size()) {
+		// QUIT only ends the main loop, so a dialog is still waiting.
+		ERROR("Input script ended with a dialog open\n");
+		exit(EXIT_FAILURE);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "/step-%03zu.png", step);
+	if (!savePNG(screen.getSurface(), dir + name)) {
+		ERROR("Unable to write step %zu of the input script\n", step);
+	}
+
+	if (step == buttons.size()) {
+		step++;
+		const string report = dir + "/latency.txt";
+		int fd = open(report.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			ERROR("Unable to write \"%s\"\n", report.c_str());
+		} else {
+			InputLatency::writeReport(fd);
+			close(fd);
+		}
+		return InputManager::QUIT;
+	}
+	return buttons[step++];
+}
@@ -0,0 +1,45 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __INPUTSCRIPT_H__
+#define __INPUTSCRIPT_H__
+
+#include "inputmanager.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class OutputSurface;
+
+/**
+ * Feeds buttons from a file instead of the user, for regression tests in
+ * headless mode. The file has one button name per line, using the names of
+ * input.conf; blank lines and lines starting with '#' are skipped.
+ * Before each button, the screen is written to step-NNN.png in the headless
+ * directory. After the last one, the latency report is written to
+ * latency.txt there and QUIT is sent.
+ */
+class InputScript {
+public:
+	/**
+	 * Loads the script named by $GMENU2X_INPUT_SCRIPT. Returns nullptr if
+	 * that is not set, can't be read or the headless backend is not used.
+	 */
+	static std::unique_ptr<InputScript> load();
+
+	/**
+	 * Saves the screen and returns the next button. Only to be called once
+	 * the UI waits for input, so that the screen shows the settled state.
+	 */
+	InputManager::Button next(OutputSurface& screen);
+
+private:
+	InputScript(std::string dir, std::vector<InputManager::Button> buttons);
+
+	std::string dir;
+	std::vector<InputManager::Button> buttons;
+	size_t step = 0;
+};
+
+#endif
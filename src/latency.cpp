@@ -0,0 +1,266 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "latency.h"
+
+#include "debug.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+#ifdef ENABLE_EVDEV_LATENCY
+#include "utilities.h"
+
+#include <deque>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <vector>
+#endif
+
+using namespace std;
+
+/** Upper bounds of the histogram buckets, in milliseconds. */
+static const unsigned int bucketLimits[] = {
+	8, 16, 24, 33, 50, 67, 100, 150, 250, 500,
+};
+static const size_t BUCKETS =
+		sizeof(bucketLimits) / sizeof(bucketLimits[0]) + 1;
+
+static const size_t MAX_CONTEXTS = 16;
+
+/** Atomic, since the report may be written by a signal handler. */
+struct LatencyStats {
+	const char *name;
+	atomic<unsigned int> count, sumMs, maxMs;
+	atomic<unsigned int> buckets[BUCKETS];
+};
+
+static LatencyStats stats[MAX_CONTEXTS];
+static atomic<size_t> numStats(0);
+static LatencyStats *currentStats = nullptr;
+
+/** Press times of the buttons that no frame has shown yet. */
+static int64_t pending[16];
+static size_t numPending = 0;
+
+/** Microseconds on the monotonic clock, the one evdev is switched to. */
+static int64_t monotonicUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#ifdef ENABLE_EVDEV_LATENCY
+
+/** Presses older than this are taken to be seen by SDL already. */
+#define STALE_PRESS_US 1000000
+
+static vector<int> devices;
+/** Times of the presses read from the devices, oldest first. */
+static deque<int64_t> pressTimes;
+
+static void openDevices()
+{
+	// Handles of our own: the reactor drains the ones it waits on.
+	for (int fd : openInputDevices()) {
+		int clock = CLOCK_MONOTONIC;
+		if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0) {
+			close(fd);
+			continue;
+		}
+		devices.push_back(fd);
+	}
+	DEBUG("Measuring input latency from %zu devices\n", devices.size());
+}
+
+static void readDevices()
+{
+	struct input_event events[16];
+	for (int fd : devices) {
+		ssize_t len;
+		while ((len = read(fd, events, sizeof(events))) > 0) {
+			for (size_t i = 0; i < len / sizeof(events[0]); i++) {
+				// Kernel repeats (value 2) are ignored: SDL does its own.
+				if (events[i].type == EV_KEY && events[i].value == 1) {
+					pressTimes.push_back(
+							(int64_t) events[i].time.tv_sec * 1000000
+							+ events[i].time.tv_usec);
+				}
+			}
+		}
+	}
+}
+
+/** Returns the time of the oldest press not matched yet, or 'now'. */
+static int64_t takePressTime(int64_t now)
+{
+	readDevices();
+	while (!pressTimes.empty() && now - pressTimes.front() > STALE_PRESS_US) {
+		pressTimes.pop_front();
+	}
+	if (pressTimes.empty()) {
+		return now;
+	}
+	const int64_t time = pressTimes.front();
+	pressTimes.pop_front();
+	return time;
+}
+
+#endif // ENABLE_EVDEV_LATENCY
+
+void InputLatency::init()
+{
+#ifdef ENABLE_EVDEV_LATENCY
+	openDevices();
+#endif
+}
+
+void InputLatency::buttonReceived([[maybe_unused]] bool pressed)
+{
+	int64_t time = monotonicUs();
+#ifdef ENABLE_EVDEV_LATENCY
+	if (pressed) {
+		time = takePressTime(time);
+	}
+#endif
+	if (numPending < sizeof(pending) / sizeof(pending[0])) {
+		pending[numPending++] = time;
+	}
+}
+
+void InputLatency::frameShown()
+{
+	if (!numPending) {
+		return;
+	}
+	if (!currentStats) {
+		setContext("other");
+	}
+
+	const int64_t now = monotonicUs();
+	for (size_t i = 0; i < numPending; i++) {
+		const unsigned int ms = (unsigned int) ((now - pending[i]) / 1000);
+		size_t bucket = 0;
+		while (bucket < BUCKETS - 1 && ms >= bucketLimits[bucket]) {
+			bucket++;
+		}
+
+		LatencyStats &s = *currentStats;
+		s.count.fetch_add(1, memory_order_relaxed);
+		s.sumMs.fetch_add(ms, memory_order_relaxed);
+		s.buckets[bucket].fetch_add(1, memory_order_relaxed);
+		if (ms > s.maxMs.load(memory_order_relaxed)) {
+			s.maxMs.store(ms, memory_order_relaxed);
+		}
+	}
+	numPending = 0;
+}
+
+void InputLatency::setContext(const char *name)
+{
+	if (!name) {
+		currentStats = nullptr;
+		return;
+	}
+
+	const size_t n = numStats.load(memory_order_relaxed);
+	for (size_t i = 0; i < n; i++) {
+		if (!strcmp(stats[i].name, name)) {
+			currentStats = &stats[i];
+			return;
+		}
+	}
+	if (n == MAX_CONTEXTS) {
+		// Full: the last context takes all the others.
+		currentStats = &stats[n - 1];
+		return;
+	}
+	stats[n].name = name;
+	numStats.store(n + 1, memory_order_release);
+	currentStats = &stats[n];
+}
+
+const char *InputLatency::getContext()
+{
+	return currentStats ? currentStats->name : nullptr;
+}
+
+/** Appends a right-aligned number to 'out'; no stdio involved. */
+static char *appendNumber(char *out, unsigned int value, int width)
+{
+	char digits[12];
+	int n = 0;
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	for (int i = n; i < width; i++) {
+		*out++ = ' ';
+	}
+	while (n) {
+		*out++ = digits[--n];
+	}
+	return out;
+}
+
+static char *appendName(char *out, const char *name)
+{
+	size_t len = strlen(name);
+	if (len > 15) {
+		len = 15;
+	}
+	memcpy(out, name, len);
+	out += len;
+	for (size_t i = len; i < 16; i++) {
+		*out++ = ' ';
+	}
+	return out;
+}
+
+void InputLatency::writeReport(int fd)
+{
+	char buf[(MAX_CONTEXTS + 2) * (16 + (BUCKETS + 3) * 6 + 1)];
+	char *out = appendName(buf, "Input latency");
+	static const char header[] = " count  mean   max";
+	memcpy(out, header, sizeof(header) - 1);
+	out += sizeof(header) - 1;
+	for (size_t i = 0; i < BUCKETS - 1; i++) {
+		*out++ = ' ';
+		*out++ = '<';
+		out = appendNumber(out, bucketLimits[i], 4);
+	}
+	static const char last[] = "  more ms\n";
+	memcpy(out, last, sizeof(last) - 1);
+	out += sizeof(last) - 1;
+
+	const size_t n = numStats.load(memory_order_acquire);
+	for (size_t i = 0; i < n; i++) {
+		LatencyStats &s = stats[i];
+		const unsigned int count = s.count.load(memory_order_relaxed);
+		out = appendName(out, s.name);
+		out = appendNumber(out, count, 6);
+		out = appendNumber(out,
+				count ? s.sumMs.load(memory_order_relaxed) / count : 0, 6);
+		out = appendNumber(out, s.maxMs.load(memory_order_relaxed), 6);
+		for (size_t b = 0; b < BUCKETS; b++) {
+			out = appendNumber(out,
+					s.buckets[b].load(memory_order_relaxed), 6);
+		}
+		*out++ = '\n';
+	}
+
+	const char *p = buf;
+	while (p < out) {
+		ssize_t written = write(fd, p, out - p);
+		if (written <= 0) {
+			if (written < 0 && errno == EINTR) continue;
+			break;
+		}
+		p += written;
+	}
+}
@@ -0,0 +1,57 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+/**
+ * Measures how long a button press takes to show up on screen: from the
+ * press until the first frame presented after the button was taken from
+ * the event queue. The results are kept in a histogram per screen (the
+ * menu, each dialog) so that optimisation can target what the user feels.
+ * With ENABLE_EVDEV_LATENCY, press times are the kernel timestamps of the
+ * input devices; otherwise they are the time SDL handed the event over,
+ * which leaves out the time spent waiting in the queue.
+ * Everything but writeReport() must be called from the main thread.
+ */
+class InputLatency {
+public:
+	/** Opens the input devices, if built with ENABLE_EVDEV_LATENCY. */
+	static void init();
+
+	/**
+	 * Called for each button taken from the event queue; 'pressed' tells
+	 * key or joystick button presses from other events.
+	 */
+	static void buttonReceived(bool pressed);
+
+	/** Called once a frame is presented. */
+	static void frameShown();
+
+	/**
+	 * Names the screen the next frames belong to. The name is kept, so it
+	 * has to be a string literal.
+	 */
+	static void setContext(const char *name);
+	static const char *getContext();
+
+	/**
+	 * Writes the histograms to the given file descriptor. Only uses write(),
+	 * so it is safe in a signal handler.
+	 */
+	static void writeReport(int fd);
+
+	/** Sets the context for as long as it exists, e.g. for a dialog loop. */
+	class Context {
+	public:
+		Context(const char *name) : previous(getContext()) {
+			setContext(name);
+		}
+		~Context() { setContext(previous); }
+
+	private:
+		const char *previous;
+	};
+};
+
+#endif // __LATENCY_H__
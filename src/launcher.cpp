@@ -1,5 +1,6 @@
 #include "launcher.h"
 #include "funkeymenu.h"
+#include "commandrunner.h"
 #include "debug.h"
 
 #include <cerrno>
@@ -32,10 +33,11 @@ Launcher::Launcher(vector<string> && commandLine, bool consoleApp)
 
 void Launcher::exec()
 {
-	FILE *fp;
+	/* Let queued commands finish, they won't survive the exec */
+	CommandRunner::wait();
 
 	/* Start audio amp */
-	system(SHELL_CMD_AUDIO_AMP_ON);
+	CommandRunner::run(SHELL_CMD_AUDIO_AMP_ON);
 
 	if (consoleApp) {
 #ifdef BIND_CONSOLE
@@ -60,15 +62,18 @@ void Launcher::exec()
 #endif
 	}
 
-	INFO("Launching '");
+	string line;
 	vector<const char *> args;
 	args.reserve(commandLine.size() + 1);
 	for (auto arg : commandLine) {
 		args.push_back(strdup(arg.c_str()));
-		INFO("%s ", args.back() );
+		line += arg + ' ';
 	}
 	args.push_back(nullptr);
-	INFO("'\n");
+	INFO("Launching '%s'\n", line.c_str());
+
+	/* The log writer thread won't survive the exec either */
+	logFlush();
 
 	execvp(commandLine[0].c_str(), (char * const *)args.data());
 	WARNING("Failed to exec '%s': %s\n",
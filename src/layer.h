@@ -20,7 +20,8 @@ public:
 	virtual ~Layer() {}
 
 	/**
-	 * Perform one frame worth of animation.
+	 * Perform one frame worth of animation; animations are based on
+	 * AnimationScheduler::frameTime(), not on the number of frames.
 	 * Returns true iff there are any animations in progress.
 	 */
 	virtual bool runAnimations() { return false; }
@@ -36,6 +37,12 @@ public:
 	 */
 	virtual bool handleButtonPress(InputManager::Button button) = 0;
 
+	/**
+	 * Name of this layer in reports, such as input latency; must be
+	 * a string literal.
+	 */
+	virtual const char *getName() = 0;
+
 	Status getStatus() { return status; }
 
 protected:
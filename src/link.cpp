@@ -42,45 +42,38 @@ Link::Link(GMenu2X& gmenu2x, Action action)
 		static_cast<decltype(SDL_Rect().w)>(gmenu2x.skinConfInt["linkWidth"]),
 		static_cast<decltype(SDL_Rect().h)>(gmenu2x.skinConfInt["linkHeight"])
 	}
+	, iconSurface(nullptr)
+	, sortLast(false)
 {
-	updateSurfaces();
 }
 
 void Link::updateTextSurfaces() {
-	updateTitleSurface();
-	updateDescriptionSurface();
+	titleSurface.reset();
+	descriptionSurface.reset();
 }
 
-void Link::updateTitleSurface() {
-	if (!title.empty()) {
-		titleSurface = gmenu2x.font->render(title);
-	} else {
-		titleSurface = nullptr;
-	}
+void Link::freeSurfaces() {
+	updateTextSurfaces();
+	iconSurface = nullptr;
 }
 
-void Link::updateDescriptionSurface() {
-	if (!description.empty()) {
-		descriptionSurface = gmenu2x.font->render(description);
-	} else {
-		descriptionSurface = nullptr;
+void Link::paint(Surface& s) {
+	if (auto icon = getIconSurface()) {
+		icon->blit(s, iconX, rect.y+padding, 32,32);
 	}
-}
-
-void Link::paint() {
-	Surface& s = *gmenu2x.s;
 
-	if (iconSurface) {
-		iconSurface->blit(s, iconX, rect.y+padding, 32,32);
+	if (!titleSurface && !title.empty()) {
+		titleSurface = gmenu2x.font->render(title);
+		if (titleSurface) titleSurface->setUse(SurfaceUse::LINK_TEXT);
+	}
+	if (titleSurface) {
+		SDL_Rect coords = {
+			static_cast<Sint16>(iconX + 16),
+			static_cast<Sint16>(rect.y + gmenu2x.skinConfInt["linkHeight"] - padding),
+			0, 0
+		};
+		titleSurface->blit(s, coords, Font::HAlignCenter, Font::VAlignBottom);
 	}
-
-	SDL_Rect coords = {
-		static_cast<Sint16>(iconX + 16),
-		static_cast<Sint16>(rect.y + gmenu2x.skinConfInt["linkHeight"] - padding),
-		0, 0
-	};
-
-	titleSurface->blit(s, coords, Font::HAlignCenter, Font::VAlignBottom);
 }
 
 void Link::paintHover() {
@@ -100,6 +93,10 @@ void Link::paintDescription(int center_x, int center_y)
 		0, 0
 	};
 
+	if (!descriptionSurface && !description.empty()) {
+		descriptionSurface = gmenu2x.font->render(description);
+		if (descriptionSurface) descriptionSurface->setUse(SurfaceUse::LINK_TEXT);
+	}
 	if (descriptionSurface != nullptr) {
 		descriptionSurface->blit(*gmenu2x.s, coords,
 				  Font::HAlignCenter, Font::VAlignBottom);
@@ -108,7 +105,15 @@ void Link::paintDescription(int center_x, int center_y)
 
 void Link::updateSurfaces()
 {
-	iconSurface = gmenu2x.sc[getIconPath()];
+	iconSurface = nullptr;
+}
+
+OffscreenSurface *Link::getIconSurface()
+{
+	if (!iconSurface) {
+		iconSurface = gmenu2x.sc[getIconPath()];
+	}
+	return iconSurface;
 }
 
 const string &Link::getTitle() const {
@@ -117,7 +122,8 @@ const string &Link::getTitle() const {
 
 void Link::setTitle(const string &title) {
 	this->title = title;
-	updateTitleSurface();
+	collationKey = case_less::to_lower(title);
+	titleSurface.reset();
 	edited = true;
 }
 
@@ -127,7 +133,7 @@ const string &Link::getDescription() const {
 
 void Link::setDescription(const string &description) {
 	this->description = description;
-	updateDescriptionSurface();
+	descriptionSurface.reset();
 	edited = true;
 }
 
@@ -193,6 +199,14 @@ void Link::recalcCoordinates() {
 	padding = (gmenu2x.skinConfInt["linkHeight"] - 32 - gmenu2x.font->getLineSpacing()) / 3;
 }
 
+bool Link::sortsBefore(Link const& other) const {
+	if (sortLast != other.sortLast) {
+		return other.sortLast;
+	}
+	int cmp = collationKey.compare(other.collationKey);
+	return cmp ? cmp < 0 : title.compare(other.title) < 0;
+}
+
 void Link::run() {
 	this->action();
 }
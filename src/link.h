@@ -29,6 +29,7 @@
 
 class GMenu2X;
 class OffscreenSurface;
+class Surface;
 
 
 /**
@@ -43,7 +44,7 @@ public:
 	Link(GMenu2X& gmenu2x, Action action);
 	virtual ~Link() {};
 
-	virtual void paint();
+	virtual void paint(Surface& s);
 	void paintHover();
 	void paintDescription(int center_x, int center_y);
 
@@ -51,6 +52,7 @@ public:
 
 	void setSize(int w, int h);
 	void setPosition(int x, int y);
+	SDL_Rect const& getRect() const { return rect; }
 
 	const std::string &getTitle() const;
 	void setTitle(const std::string &title);
@@ -61,7 +63,21 @@ public:
 	void setIcon(const std::string &icon);
 	const std::string &getIconPath();
 
+	/** Drops the rendered texts, for instance when the font changed. */
 	void updateTextSurfaces();
+	/**
+	 * Drops the surfaces of the link, to save memory while it isn't shown.
+	 * They are made again when the link is painted.
+	 */
+	void freeSurfaces();
+	/** Tells whether the link holds on to its icon surface. */
+	bool hasIconSurface() const { return iconSurface != nullptr; }
+
+	/**
+	 * Tells whether this link goes before the other one in a section:
+	 * OPKs go last, then links are ordered by title, ignoring case.
+	 */
+	bool sortsBefore(Link const& other) const;
 
 	void run();
 
@@ -70,18 +86,17 @@ protected:
 	bool edited;
 	std::string launchMsg, icon, iconPath;
 
-	OffscreenSurface *iconSurface;
-	std::unique_ptr<OffscreenSurface> titleSurface;
-	std::unique_ptr<OffscreenSurface> descriptionSurface;
-
 	virtual const std::string &searchIcon();
 	void setIconPath(const std::string &icon);
 	void updateSurfaces();
+	/** Returns the icon surface, loading it if needed. */
+	OffscreenSurface *getIconSurface();
+
+	/** Moves the link after the ones which don't have this flag set. */
+	void setSortLast(bool sortLast) { this->sortLast = sortLast; }
 
 private:
 	void recalcCoordinates();
-	void updateTitleSurface();
-	void updateDescriptionSurface();
 
 	Action action;
 
@@ -89,6 +104,15 @@ private:
 	uint32_t iconX, padding;
 	int lastTick;
 	std::string title, description;
+
+	// Loaded or rendered on first use.
+	OffscreenSurface *iconSurface;
+	std::unique_ptr<OffscreenSurface> titleSurface;
+	std::unique_ptr<OffscreenSurface> descriptionSurface;
+
+	/** The title folded to lower case, so sorting doesn't redo it. */
+	std::string collationKey;
+	bool sortLast;
 };
 
 #endif
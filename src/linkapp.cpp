@@ -23,9 +23,12 @@
 #include "debug.h"
 #include "buildopts.h"
 #include "gmenu2x.h"
+#include "imageio.h"
+#include "latency.h"
 #include "launcher.h"
 #include "layer.h"
 #include "menu.h"
+#include "opkpool.h"
 #include "selector.h"
 #include "surface.h"
 #include "textmanualdialog.h"
@@ -39,10 +42,12 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#include <algorithm>
 #include <array>
 #include <cerrno>
 #include <fstream>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #ifdef HAVE_LIBOPK
@@ -73,6 +78,10 @@ public:
 		return true;
 	}
 
+	const char *getName() override {
+		return "launch";
+	}
+
 private:
 	LinkApp& app;
 };
@@ -104,6 +113,7 @@ LinkApp::LinkApp(GMenu2X& gmenu2x, string const& linkfile, bool deletable)
 	bool appTakesFileArg = true;
 #ifdef HAVE_LIBOPK
 	isOPK = !!opk;
+	setSortLast(isOPK);
 
 	if (isOPK) {
 		string::size_type pos;
@@ -399,8 +409,8 @@ void LinkApp::drawLaunch(Surface& s) {
 		gmenu2x.sc[getIcon()]->blit(gmenu2x.s,x,104);
 	else
 		gmenu2x.sc["icons/generic.png"]->blit(gmenu2x.s,x,104);*/
-	if (iconSurface) {
-		iconSurface->blit(s, x, gmenu2x.height() / 2 - 16);
+	if (auto icon = getIconSurface()) {
+		icon->blit(s, x, gmenu2x.height() / 2 - 16);
 	}
 	gmenu2x.font->write(s, text, x + 42, gmenu2x.height() / 2 + 1,
 			    Font::HAlignLeft, Font::VAlignMiddle);
@@ -415,21 +425,15 @@ void LinkApp::start() {
 }
 
 void LinkApp::showManual() {
+	InputLatency::Context latency("manual");
 	if (manual.empty())
 		return;
 
 #ifdef HAVE_LIBOPK
 	if (isOPK) {
-		struct OPK *opk = opk_open(opkFile.c_str());
-		if (!opk) {
-			WARNING("Unable to open OPK to read manual\n");
-			return;
-		}
-
 		void *buf;
 		size_t len;
-		int err = opk_extract_file(opk, manual.c_str(), &buf, &len);
-		opk_close(opk);
+		int err = OpkPool::readFile(opkFile, manual, &buf, &len);
 		if (err < 0) {
 			WARNING("Unable to extract manual from OPK\n");
 			return;
@@ -452,45 +456,121 @@ void LinkApp::showManual() {
 
 	// Png manuals
 	if (manual.substr(manual.size()-8,8)==".man.png") {
-		auto pngman = OffscreenSurface::loadImage(manual);
-		if (!pngman) {
+		unsigned int manWidth, manHeight;
+		if (!readPNGSize(manual, manWidth, manHeight)) {
 			return;
 		}
-		auto bg = OffscreenSurface::loadImage(gmenu2x.confStr["wallpaper"]);
+		auto bg = OffscreenSurface::loadImage(gmenu2x.confStr["wallpaper"], false);
 		if (!bg) {
 			bg = OffscreenSurface::emptySurface(gmenu2x.width(), gmenu2x.height());
 		}
+		bg->setUse(SurfaceUse::DIALOG);
 		bg->convertToDisplayFormat();
 
 		stringstream ss;
 		string pageStatus;
 
 		bool close = false, repaint = true;
-		int page = 0, pagecount = pngman->width() / gmenu2x.width();
+		const int pageWidth = gmenu2x.width();
+		int page = 0, pagecount = max(manWidth / pageWidth, 1u);
+
+		// Pages are decoded on demand; only the visible page and its
+		// neighbours are kept, so memory use doesn't depend on the length
+		// of the manual. Every row of the strip has to be inflated in full,
+		// so the pages missing from that window are cropped out of a
+		// single pass, and after a page turn that pass runs on a thread
+		// while the page is being read.
+		unique_ptr<OffscreenSurface> pages[3];
+		int firstPage = 0;
+		auto scrollPages = [&](int first) {
+			unique_ptr<OffscreenSurface> old[3];
+			for (int i = 0; i < 3; i++) old[i] = move(pages[i]);
+			for (int i = 0; i < 3; i++) {
+				int j = first + i - firstPage;
+				if (j >= 0 && j < 3) pages[i] = move(old[j]);
+			}
+			firstPage = first;
+		};
+		auto missingPages = [&]() {
+			vector<int> missing;
+			for (int i = 0; i < 3; i++) {
+				int p = firstPage + i;
+				if (p >= 0 && p < pagecount && !pages[i]) missing.push_back(p);
+			}
+			return missing;
+		};
+		const unsigned int pageHeight = min(manHeight, gmenu2x.height());
+		auto decodePages = [path = manual, manWidth, pageWidth, pageHeight](
+				vector<int> const& numbers) {
+			vector<PNGRegion> regions;
+			for (int p : numbers) {
+				const unsigned int x = p * pageWidth;
+				regions.push_back({ x, 0,
+						min(manWidth - x, (unsigned int)pageWidth), pageHeight });
+			}
+			return OffscreenSurface::loadImageParts(path, regions);
+		};
+		auto storePages = [&](vector<int> const& numbers,
+				vector<unique_ptr<OffscreenSurface>>& decoded) {
+			for (size_t i = 0; i < decoded.size(); i++) {
+				int j = numbers[i] - firstPage;
+				if (j >= 0 && j < 3 && !pages[j]) {
+					decoded[i]->setUse(SurfaceUse::DIALOG);
+					pages[j] = move(decoded[i]);
+				}
+			}
+		};
+
+		// Only touched by the prefetch thread while it runs.
+		vector<int> prefetchNumbers;
+		vector<unique_ptr<OffscreenSurface>> prefetched;
+		thread prefetcher;
+		auto finishPrefetch = [&]() {
+			if (prefetcher.joinable()) {
+				prefetcher.join();
+				storePages(prefetchNumbers, prefetched);
+				prefetched.clear();
+			}
+		};
 
 		ss << pagecount;
 		string spagecount;
 		ss >> spagecount;
 
+		Translator &tr = gmenu2x.tr;
+		const auto changePageLabel = tr.intern("Change page");
+		const auto exitLabel = tr.intern("Exit");
+		const auto pageLabel = tr.intern("Page");
+
 		while (!close) {
 			OutputSurface& s = *gmenu2x.s;
 
 			if (repaint) {
+				finishPrefetch();
+				scrollPages(page - 1);
+				if (!pages[1]) {
+					// Opening, or the prefetch failed.
+					auto missing = missingPages();
+					auto decoded = decodePages(missing);
+					storePages(missing, decoded);
+				}
 				bg->blit(s, 0, 0);
-				pngman->blit(s, -page * gmenu2x.width(), 0);
+				if (pages[1]) {
+					pages[1]->blit(s, 0, 0);
+				}
 
 				gmenu2x.drawBottomBar(s);
 				int x = 5;
 				x = gmenu2x.drawButton(s, "left", "", x);
-				x = gmenu2x.drawButton(s, "right", gmenu2x.tr["Change page"], x);
+				x = gmenu2x.drawButton(s, "right", tr[changePageLabel], x);
 				x = gmenu2x.drawButton(s, "cancel", "", x);
-				x = gmenu2x.drawButton(s, "start", gmenu2x.tr["Exit"], x);
+				x = gmenu2x.drawButton(s, "start", tr[exitLabel], x);
 				(void)x;
 
 				ss.clear();
 				ss << page+1;
 				ss >> pageStatus;
-				pageStatus = gmenu2x.tr["Page"]+": "+pageStatus+"/"+spagecount;
+				pageStatus = tr[pageLabel]+": "+pageStatus+"/"+spagecount;
 				gmenu2x.font->write(s, pageStatus,
 						    gmenu2x.width() - 10,
 						    gmenu2x.height() - 10,
@@ -499,6 +579,14 @@ void LinkApp::showManual() {
 
 				s.flip();
 				repaint = false;
+
+				// Prefetch the neighbours while the page is being read.
+				prefetchNumbers = missingPages();
+				if (!prefetchNumbers.empty()) {
+					prefetcher = thread([&]() {
+						prefetched = decodePages(prefetchNumbers);
+					});
+				}
 			}
 
             switch(gmenu2x.input.waitForPressedButton()) {
@@ -522,6 +610,7 @@ void LinkApp::showManual() {
                     break;
             }
         }
+		finishPrefetch();
 		return;
 	}
 
@@ -564,6 +653,12 @@ void LinkApp::selector(int startSelection, const string &selectorDir) {
 	}
 }
 
+void LinkApp::launch(const string &dir, const string &file) {
+	gmenu2x.queueLaunch(
+			prepareLaunch(dir + file),
+			make_shared<LaunchLayer>(*this));
+}
+
 unique_ptr<Launcher> LinkApp::prepareLaunch(const string &selectedFile) {
 	if (!save()) {
 		ERROR("Error saving app settings to '%s'.\n", file.c_str());
@@ -59,6 +59,7 @@ public:
 	const std::string &getCategory() { return category; }
 	bool isOpk() { return isOPK; }
 	const std::string &getOpkFile() { return opkFile; }
+	const std::string &getMetadata() { return metadata; }
 
 	LinkApp(GMenu2X& gmenu2x, std::string const& linkfile, bool deletable,
 				struct OPK *opk = NULL, const char *metadata = NULL);
@@ -88,6 +89,13 @@ public:
 	bool save();
 	void showManual();
 	void selector(int startSelection=0, const std::string &selectorDir="");
+	/**
+	 * Launches the link on the given file, as if it was picked in the
+	 * selector. 'dir' must end with a slash.
+	 * Unlike the selector, this does not remember the file's directory,
+	 * since the search index is rooted at the selector directory.
+	 */
+	void launch(const std::string &dir, const std::string &file);
 	bool targetExists();
 	bool isDeletable() { return deletable; }
 	bool isEditable() { return editable; }
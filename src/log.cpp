@@ -0,0 +1,264 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstring>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+/** Longer messages are truncated. */
+const size_t MESSAGE_SIZE = 512;
+/** Must be a power of two. */
+const size_t SLOTS = 128;
+
+/** Messages allowed per call site in each window. */
+const unsigned int RATE_LIMIT = 20;
+const long RATE_WINDOW_MS = 1000;
+
+struct Slot {
+	/** Tells whose turn it is to use the slot: see push() and pop(). */
+	atomic<size_t> sequence;
+	FILE *stream;
+	chrono::steady_clock::duration time;
+	char text[MESSAGE_SIZE];
+};
+
+/**
+ * A bounded queue with any number of producers and a single consumer,
+ * after Dmitry Vyukov's design. Slot i is free for the producer at
+ * position p if its sequence is p, and holds a message for the consumer
+ * at position p if its sequence is p + 1.
+ */
+class LogQueue {
+public:
+	LogQueue();
+
+	Slot *beginPush();
+	void endPush(Slot *slot);
+
+	Slot *beginPop();
+	void endPop(Slot *slot);
+
+	bool empty() const {
+		return tail == head.load(memory_order_acquire);
+	}
+
+	atomic<unsigned int> dropped { 0 };
+
+private:
+	Slot slots[SLOTS];
+	atomic<size_t> head { 0 };
+	size_t tail = 0;
+};
+
+LogQueue::LogQueue()
+{
+	for (size_t i = 0; i < SLOTS; i++) {
+		slots[i].sequence.store(i, memory_order_relaxed);
+	}
+}
+
+Slot *LogQueue::beginPush()
+{
+	size_t pos = head.load(memory_order_relaxed);
+	for (;;) {
+		Slot *slot = &slots[pos & (SLOTS - 1)];
+		const size_t sequence = slot->sequence.load(memory_order_acquire);
+		const ptrdiff_t diff = (ptrdiff_t) sequence - (ptrdiff_t) pos;
+		if (diff == 0) {
+			if (head.compare_exchange_weak(pos, pos + 1,
+					memory_order_relaxed)) {
+				return slot;
+			}
+		} else if (diff < 0) {
+			// Full: the writer is behind.
+			return nullptr;
+		} else {
+			pos = head.load(memory_order_relaxed);
+		}
+	}
+}
+
+void LogQueue::endPush(Slot *slot)
+{
+	// The slot was taken at the position its sequence had.
+	slot->sequence.store(slot->sequence.load(memory_order_relaxed) + 1,
+			memory_order_release);
+}
+
+Slot *LogQueue::beginPop()
+{
+	Slot *slot = &slots[tail & (SLOTS - 1)];
+	if (slot->sequence.load(memory_order_acquire) != tail + 1) {
+		return nullptr;
+	}
+	return slot;
+}
+
+void LogQueue::endPop(Slot *slot)
+{
+	slot->sequence.store(tail + SLOTS, memory_order_release);
+	tail++;
+}
+
+/** Writes the queued messages on a thread of its own. */
+class LogWriter {
+public:
+	static LogWriter &instance();
+
+	LogQueue queue;
+
+	void wake();
+	void flush();
+
+private:
+	LogWriter();
+	void run();
+	void write(Slot const& slot);
+
+	mutex lock;
+	condition_variable wakeup, drained;
+	/** Set under the lock when there is work, so no wake-up is missed. */
+	bool pending = false;
+	/** Whether the next text written to stdout / stderr starts a line. */
+	bool lineStart[2] = { true, true };
+};
+
+LogWriter &LogWriter::instance()
+{
+	// Never destroyed: its thread is detached and may still be writing
+	// while static objects are destroyed.
+	static LogWriter *writer = new LogWriter;
+	return *writer;
+}
+
+LogWriter::LogWriter()
+{
+	thread(&LogWriter::run, this).detach();
+	atexit(&logFlush);
+}
+
+void LogWriter::run()
+{
+	unique_lock<mutex> guard(lock);
+	for (;;) {
+		// Sleeps until there is something to write: no idle wake-ups.
+		wakeup.wait(guard, [this] { return pending; });
+		pending = false;
+		guard.unlock();
+
+		while (Slot *slot = queue.beginPop()) {
+			write(*slot);
+			queue.endPop(slot);
+		}
+		if (unsigned int dropped = queue.dropped.exchange(0)) {
+			fprintf(stderr, "WARNING: %u log messages dropped\n", dropped);
+			lineStart[1] = true;
+		}
+		fflush(stdout);
+		fflush(stderr);
+
+		guard.lock();
+		drained.notify_all();
+	}
+}
+
+void LogWriter::wake()
+{
+	// Only held by the writer while it checks for work, so this is short.
+	{
+		lock_guard<mutex> guard(lock);
+		pending = true;
+	}
+	wakeup.notify_one();
+}
+
+void LogWriter::write(Slot const& slot)
+{
+	bool &atLineStart = lineStart[slot.stream == stderr];
+	if (atLineStart) {
+		const long ms = chrono::duration_cast<chrono::milliseconds>(
+				slot.time).count();
+		fprintf(slot.stream, "[%5ld.%03ld] ", ms / 1000, ms % 1000);
+	}
+	fputs(slot.text, slot.stream);
+
+	const size_t len = strlen(slot.text);
+	atLineStart = len && slot.text[len - 1] == '\n';
+}
+
+void LogWriter::flush()
+{
+	unique_lock<mutex> guard(lock);
+	const auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+	while (!queue.empty()) {
+		pending = true;
+		wakeup.notify_one();
+		if (drained.wait_until(guard, deadline) == cv_status::timeout) {
+			break;
+		}
+	}
+}
+
+long monotonicMs()
+{
+	return chrono::duration_cast<chrono::milliseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+void logWrite(FILE *stream, const char *format, ...)
+{
+	LogWriter &writer = LogWriter::instance();
+	Slot *slot = writer.queue.beginPush();
+	if (!slot) {
+		writer.queue.dropped++;
+		return;
+	}
+
+	slot->stream = stream;
+	slot->time = chrono::steady_clock::now().time_since_epoch();
+	va_list args;
+	va_start(args, format);
+	vsnprintf(slot->text, sizeof(slot->text), format, args);
+	va_end(args);
+
+	writer.queue.endPush(slot);
+	writer.wake();
+}
+
+void logFlush()
+{
+	LogWriter::instance().flush();
+}
+
+bool LogRateLimit::allow(FILE *stream)
+{
+	const long now = monotonicMs();
+	long start = windowStart.load(memory_order_relaxed);
+	if (start < 0 || now - start >= RATE_WINDOW_MS) {
+		if (windowStart.compare_exchange_strong(start, now,
+				memory_order_relaxed)) {
+			count.store(0, memory_order_relaxed);
+			if (unsigned int n = suppressed.exchange(0)) {
+				logWrite(stream, "(%u similar messages suppressed)\n", n);
+			}
+		}
+	}
+
+	if (count.fetch_add(1, memory_order_relaxed) < RATE_LIMIT) {
+		return true;
+	}
+	suppressed++;
+	return false;
+}
@@ -0,0 +1,47 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <atomic>
+#include <cstdio>
+
+/**
+ * Backend of the logging macros of debug.h.
+ * Messages are formatted by the caller into a lock-free ring buffer and
+ * written by a background thread, with a monotonic timestamp, so that
+ * logging to a slow SD card doesn't block the UI thread. If the buffer is
+ * full, messages are dropped and the number of them is logged later.
+ */
+
+/** Queues a message; 'stream' is stdout or stderr. */
+void logWrite(FILE *stream, const char *format, ...)
+		__attribute__((format(printf, 2, 3)));
+
+/**
+ * Waits until the queued messages are written, e.g. before exec().
+ * Also done at exit.
+ */
+void logFlush();
+
+/**
+ * Limits the number of messages from a single call site, so that a message
+ * logged on every frame doesn't flood the log.
+ */
+class LogRateLimit {
+public:
+	/** Returns true if a message may be logged from this call site now. */
+	bool allow(FILE *stream);
+
+private:
+	std::atomic<long> windowStart { -1 };
+	std::atomic<unsigned int> count { 0 }, suppressed { 0 };
+};
+
+#define LOG_MESSAGE(stream, ...) do { \
+		static LogRateLimit logRateLimit_; \
+		if (logRateLimit_.allow(stream)) logWrite(stream, __VA_ARGS__); \
+	} while (0)
+
+#endif // __LOG_H__
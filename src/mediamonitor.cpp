@@ -1,20 +1,20 @@
 #ifdef ENABLE_INOTIFY
-#include <memory>
+#include <cstring>
 
+#include <dirent.h>
 #include <sys/inotify.h>
-#include <SDL/SDL.h>
-#include <unistd.h>
 
 #include "debug.h"
-#include "inputmanager.h"
 #include "mediamonitor.h"
-#include "menu.h"
-#include "utilities.h"
+#include "monitorqueue.h"
 
 using namespace std;
 
-MediaMonitor::MediaMonitor(string dir, Menu *menu) :
-	Monitor(dir, menu, IN_MOVE | IN_DELETE | IN_CREATE | IN_ONLYDIR)
+/** How long to wait for a new directory to become a mount point. */
+static const int MOUNT_TIMEOUT_MS = 3000;
+
+MediaMonitor::MediaMonitor(string dir, MonitorQueue &queue) :
+	Monitor(dir, queue, IN_MOVE | IN_DELETE | IN_CREATE | IN_ONLYDIR)
 {
 }
 
@@ -26,17 +26,39 @@ bool MediaMonitor::event_accepted(
 
 void MediaMonitor::inject_event(bool is_add, const char *path)
 {
-	/* Sleep for a bit, to ensure that the media will be mounted
-	 * on the mountpoint before we start looking for OPKs */
-	sleep(1);
-
 	if (is_add)
-		//menu->openPackagesFromDir(((string)path + "/apps").c_str());
-		menu->openPackagesFromDir(((string)path).c_str());
+		/* Make sure that the media is mounted on the mountpoint
+		 * before we start looking for OPKs */
+		wait_for_mount(path, MOUNT_TIMEOUT_MS);
 	else
-		menu->removePackageLink(path);
+		queue.push(MonitorQueue::Type::DIR_REMOVED, path);
+}
+
+void MediaMonitor::mount_ready(const char *path, bool mounted)
+{
+	if (!mounted)
+		DEBUG("%s is not a mount point, scanning it anyway\n", path);
+
+	queue.push(MonitorQueue::Type::DIR_ADDED, path);
+}
+
+void MediaMonitor::rescan()
+{
+	queue.push(MonitorQueue::Type::DIR_RESCAN, getPath());
+
+	DIR *dirp = opendir(getPath().c_str());
+	if (!dirp)
+		return;
+
+	while (struct dirent *dptr = readdir(dirp)) {
+		if (dptr->d_type != DT_DIR || !strcmp(dptr->d_name, ".")
+				|| !strcmp(dptr->d_name, ".."))
+			continue;
 
-	request_repaint();
+		queue.push(MonitorQueue::Type::DIR_ADDED,
+				getPath() + '/' + dptr->d_name);
+	}
+	closedir(dirp);
 }
 
 #endif /* ENABLE_INOTIFY */
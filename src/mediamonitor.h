@@ -6,12 +6,14 @@
 
 class MediaMonitor: public Monitor {
 	public:
-		MediaMonitor(std::string dir, Menu *menu);
+		MediaMonitor(std::string dir, MonitorQueue &queue);
 		virtual ~MediaMonitor() { };
 
 	private:
 		virtual bool event_accepted(struct inotify_event &event);
 		virtual void inject_event(bool is_add, const char *path);
+		virtual void rescan();
+		virtual void mount_ready(const char *path, bool mounted);
 };
 
 #endif /* ENABLE_INOTIFY */
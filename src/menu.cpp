@@ -29,6 +29,7 @@
 #include <cerrno>
 #include <cstring>
 #include <system_error>
+#include <unordered_set>
 
 #include "compat-filesystem.h"
 
@@ -41,6 +42,7 @@
 #include "linkapp.h"
 #include "menu.h"
 #include "monitor.h"
+#include "opkpool.h"
 #include "filelister.h"
 #include "utilities.h"
 #include "debug.h"
@@ -48,39 +50,24 @@
 using namespace std;
 
 
-Menu::Animation::Animation()
-	: curr(0)
-{
-}
-
-void Menu::Animation::adjust(int delta)
-{
-	curr += delta;
-}
-
-void Menu::Animation::step()
-{
-	if (curr == 0) {
-		ERROR("Computing step past animation end\n");
-	} else if (curr < 0) {
-		const int v = ((1 << 16) - curr) / 32;
-		curr = std::min(0, curr + v);
-	} else {
-		const int v = ((1 << 16) + curr) / 32;
-		curr = std::max(0, curr - v);
-	}
-}
+/** Time the sections take to slide into place, in milliseconds. */
+#define SECTION_SLIDE_DURATION 300
 
 Menu::Menu(GMenu2X& gmenu2x)
 	: gmenu2x(gmenu2x)
 	, btnContextMenu(gmenu2x, "skin:imgs/menu.png", "",
 			std::bind(&GMenu2X::showContextMenu, &gmenu2x))
+	, iSection(0)
+	, iLink(0)
+	, iFirstDispRow(0)
+	, pagesSize(0)
+	, layoutSection(-1)
+	, layoutFirstRow(0)
 {
 	readSections(GMENU2X_SYSTEM_DIR "/sections");
 	readSections(GMenu2X::getHome() + "/sections");
 
-	setSectionIndex(0);
-	readLinks();
+	// No section is loaded yet: GMenu2X selects the one it was left on.
 
 #ifdef HAVE_LIBOPK
 	{
@@ -106,8 +93,6 @@ Menu::Menu(GMenu2X& gmenu2x)
 
 	btnContextMenu.setPosition(gmenu2x.width() - 38,
 				   gmenu2x.bottomBarIconY);
-
-	updateSectionTextSurfaces();
 }
 
 Menu::~Menu()
@@ -117,13 +102,19 @@ Menu::~Menu()
 void Menu::readSections(std::string const& parentDir)
 {
 	std::error_code ec;
+	vector<string> names;
 	for (const auto& entry : compat::filesystem::directory_iterator(parentDir, ec))
 	{
 		const auto filename = entry.path().filename().string();
 		if (filename[0] != '.')
-			sectionNamed(filename);
+			names.push_back(filename);
 	}
 	//TODO: report anything in case of error?
+
+	sort(names.begin(), names.end());
+	for (auto& name : names) {
+		sectionNamed(name);
+	}
 }
 
 string Menu::createSectionDir(string const& sectionName)
@@ -147,16 +138,15 @@ void Menu::skinUpdated() {
 	linkRows = (gmenu2x.height() - 35 - skinConfInt["topBarHeight"])
 		 / skinConfInt["linkHeight"];
 
+	invalidatePages();
+
 	//reload section icons
-	decltype(links)::size_type i = 0;
-	for (auto& sectionName : sections) {
-		gmenu2x.sc["skin:sections/" + sectionName + ".png"];
+	for (size_t i = 0; i < sections.size(); i++) {
+		updateSectionHeader(i);
 
 		for (auto& link : links[i]) {
 			link->loadIcon();
 		}
-
-		i++;
 	}
 }
 
@@ -164,14 +154,18 @@ void Menu::fontChanged() {
 	for (auto &section_links : links)
 		for (auto& link : section_links)
 			link->updateTextSurfaces();
-	updateSectionTextSurfaces();
+	for (size_t i = 0; i < sections.size(); i++)
+		updateSectionHeader(i);
+	invalidatePages();
 }
 
-void Menu::updateSectionTextSurfaces() {
-	const auto &font = *gmenu2x.font;
-	section_text_surfaces.resize(sections.size());
-	for (std::size_t i = 0; i < sections.size(); ++i)
-		section_text_surfaces[i] = font.render(sections[i]);
+void Menu::updateSectionHeader(uint32_t section) {
+	auto& header = sectionHeaders[section];
+	header.icon = gmenu2x.sc["skin:sections/" + sections[section] + ".png"];
+	if (!header.icon)
+		header.icon = gmenu2x.sc.skinRes("icons/section.png");
+	header.label = gmenu2x.font->render(sections[section]);
+	if (header.label) header.label->setUse(SurfaceUse::SECTION_LABEL);
 }
 
 void Menu::calcSectionRange(int &leftSection, int &rightSection) {
@@ -188,9 +182,10 @@ void Menu::calcSectionRange(int &leftSection, int &rightSection) {
 }
 
 bool Menu::runAnimations() {
-	if (sectionAnimation.isRunning()) {
-		sectionAnimation.step();
-	}
+#if defined(HAVE_LIBOPK) && defined(ENABLE_INOTIFY)
+	processMonitorEvents();
+#endif
+
 	return sectionAnimation.isRunning();
 }
 
@@ -203,7 +198,6 @@ void Menu::paint(Surface &s) {
 	const int topBarHeight = skinConfInt["topBarHeight"];
 	const int bottomBarHeight = skinConfInt["bottomBarHeight"];
 	const int linkWidth = skinConfInt["linkWidth"];
-	const int linkHeight = skinConfInt["linkHeight"];
 	RGBAColor &selectionBgColor = gmenu2x.skinConfColors[COLOR_SELECTION_BG];
 
 	// Apply section header animation.
@@ -225,10 +219,7 @@ void Menu::paint(Surface &s) {
 	const uint32_t numSections = sections.size();
 	for (int i = leftSection; i <= rightSection; i++) {
 		uint32_t j = (centerSection + numSections + i) % numSections;
-		string sectionIcon = "skin:sections/" + sections[j] + ".png";
-		Surface *icon = sc.exists(sectionIcon)
-				? sc[sectionIcon]
-				: sc.skinRes("icons/section.png");
+		auto& header = sectionHeaders[j];
 		int x = width / 2 + i * linkWidth + sectionDelta;
 		if (i == leftSection) {
 			int t = sectionDelta > 0 ? linkWidth - sectionDelta : -sectionDelta;
@@ -237,10 +228,11 @@ void Menu::paint(Surface &s) {
 			int t = sectionDelta < 0 ? sectionDelta + linkWidth : sectionDelta;
 			x += (((t * t) / linkWidth) * t) / linkWidth;
 		}
-		icon->blit(s, x - 16, sectionLinkPadding, 32, 32);
+		if (header.icon)
+			header.icon->blit(s, x - 16, sectionLinkPadding, 32, 32);
 		
 		// Center text horizontally and align to bottom.
-		const auto *text_surface = section_text_surfaces[j].get();
+		const auto *text_surface = header.label.get();
 		text_surface->blit(
 			s,
 			x - text_surface->width() / 2,
@@ -257,34 +249,44 @@ void Menu::paint(Surface &s) {
 			r_button->blit(s, width - 10, 0);
 	}
 
-	auto& sectionLinks = links[iSection];
-	auto numLinks = sectionLinks.size();
+	//Links
+	// While switching sections, the pages slide along with the headers.
+	SDL_Rect area = linkArea();
+	auto blitPage = [&](int section, int offset) {
+		const int n = numSections;
+		section = (section % n + n) % n;
+		uint32_t firstRow = section == iSection ? iFirstDispRow : 0;
+		getPage(section, firstRow).blitRegion(
+				s, area, area.x + offset, area.y);
+	};
+	const int pageWidth = width;
+	int pageDelta = (sectionFP * pageWidth + (1 << 15)) >> 16;
+	int pageSection = iSection - pageDelta / pageWidth;
+	pageDelta %= pageWidth;
+	blitPage(pageSection, pageDelta);
+	if (pageDelta > 0) {
+		blitPage(pageSection - 1, pageDelta - pageWidth);
+	} else if (pageDelta < 0) {
+		blitPage(pageSection + 1, pageDelta + pageWidth);
+	}
+
+	auto numLinks = links[iSection].size();
 	gmenu2x.drawScrollBar(
 			linkRows, (numLinks + linkColumns - 1) / linkColumns, iFirstDispRow);
 
-	//Links
-	const uint32_t linksPerPage = linkColumns * linkRows;
-	const int linkSpacingX = (width - 10 - linkColumns * linkWidth) / linkColumns;
-	const int linkMarginX = (
-			width - linkWidth * linkColumns - linkSpacingX * (linkColumns - 1)
-			) / 2;
-	const int linkSpacingY = (height - 35 - topBarHeight - linkRows * linkHeight) / linkRows;
-	for (uint32_t i = iFirstDispRow * linkColumns; i < iFirstDispRow * linkColumns + linksPerPage && i < numLinks; i++) {
-		const int ir = i - iFirstDispRow * linkColumns;
-		const int x = linkMarginX + (ir % linkColumns) * (linkWidth + linkSpacingX);
-		const int y = ir / linkColumns * (linkHeight + linkSpacingY) + topBarHeight + 2;
-		sectionLinks.at(i)->setPosition(x, y);
-
-		if (i == (uint32_t)iLink) {
-			sectionLinks.at(i)->paintHover();
+	// The selection goes between the background and the link, so the link
+	// is drawn again over a clean background.
+	if (Link *link = selLink()) {
+		if (!sectionAnimation.isRunning()) {
+			layoutPage(iSection, iFirstDispRow);
+			SDL_Rect rect = link->getRect();
+			gmenu2x.bgmain->blitRegion(s, rect, rect.x, rect.y);
+			link->paintHover();
+			link->paint(s);
 		}
-
-		sectionLinks.at(i)->paint();
+		link->paintDescription(width / 2, height - bottomBarHeight + 2);
 	}
 
-	if (selLink())
-		selLink()->paintDescription(width / 2, height - bottomBarHeight + 2);
-
 	LinkApp *linkApp = selLinkApp();
 	if (linkApp && linkApp->isEditable()) {
 #ifdef ENABLE_CPUFREQ
@@ -344,16 +346,24 @@ vector<unique_ptr<Link>> *Menu::sectionLinks(int i)
 		return nullptr;
 	}
 
+	loadSection(i);
 	return &links[i];
 }
 
+void Menu::slideSections(int delta) {
+	// Pressing again while sliding adds to the distance left to go.
+	int from = sectionAnimation.currentValue() + delta;
+	sectionAnimation.start(from, 0, SECTION_SLIDE_DURATION,
+			Animation::Curve::EASE_OUT);
+}
+
 void Menu::decSectionIndex() {
-	sectionAnimation.adjust(-(1 << 16));
+	slideSections(-(1 << 16));
 	setSectionIndex(iSection - 1);
 }
 
 void Menu::incSectionIndex() {
-	sectionAnimation.adjust(1 << 16);
+	slideSections(1 << 16);
 	setSectionIndex(iSection + 1);
 }
 
@@ -374,6 +384,10 @@ void Menu::setSectionIndex(int i) {
 
 	iLink = 0;
 	iFirstDispRow = 0;
+
+	if (!sections.empty()) {
+		touchSection(iSection);
+	}
 }
 
 /*====================================
@@ -395,7 +409,7 @@ void Menu::addActionLink(uint32_t section, string const& title, Action action,
 		link->setIcon(icon);
 	}
 
-	links[section].emplace_back(link);
+	insertLink(section, link);
 }
 
 bool Menu::addLink(string const& path, string const& file)
@@ -472,7 +486,7 @@ bool Menu::addLink(string const& path, string const& file)
 		auto idx = sectionNamed(sectionName);
 		auto link = new LinkApp(gmenu2x, linkpath, true);
 		link->setSize(gmenu2x.skinConfInt["linkWidth"], gmenu2x.skinConfInt["linkHeight"]);
-		links[idx].emplace_back(link);
+		insertLink(idx, link);
 	} else {
 
 		ERROR("Error while opening the file '%s' for write.\n", linkpath.c_str());
@@ -490,16 +504,28 @@ int Menu::sectionNamed(const char *sectionName)
 	if (it == sections.end() || *it != sectionName) {
 		sections.emplace(it, sectionName);
 		links.emplace(links.begin() + idx);
+		loadedSections.insert(loadedSections.begin() + idx, false);
+		sectionHeaders.emplace(sectionHeaders.begin() + idx);
+		updateSectionHeader(idx);
 		// Make sure the selected section doesn't change.
-		if (idx <= iSection) {
+		if (idx <= iSection && sections.size() > 1) {
 			iSection++;
 		}
 
-		updateSectionTextSurfaces();
+		invalidatePages();
 	}
 	return idx;
 }
 
+int Menu::findSection(string const& sectionName) const
+{
+	auto it = lower_bound(sections.begin(), sections.end(), sectionName);
+	if (it == sections.end() || *it != sectionName) {
+		return -1;
+	}
+	return it - sections.begin();
+}
+
 void Menu::deleteSelectedLink()
 {
 	string iconpath = selLink()->getIconPath();
@@ -508,7 +534,11 @@ void Menu::deleteSelectedLink()
 
 	if (selLinkApp()!=NULL)
 		unlink(selLinkApp()->getFile().c_str());
+#ifdef ENABLE_INOTIFY
+	unindexLink(selLink());
+#endif
 	sectionLinks()->erase( sectionLinks()->begin() + selLinkIndex() );
+	invalidatePages();
 	setLinkIndex(selLinkIndex());
 
 	bool icon_used = false;
@@ -531,8 +561,16 @@ void Menu::deleteSelectedSection()
 
 	gmenu2x.sc.del("sections/" + sectionName + ".png");
 	auto idx = selSectionIndex();
+#ifdef ENABLE_INOTIFY
+	for (auto& link : links[idx]) {
+		unindexLink(link.get());
+	}
+#endif
 	links.erase(links.begin() + idx);
+	loadedSections.erase(loadedSections.begin() + idx);
+	sectionHeaders.erase(sectionHeaders.begin() + idx);
 	sections.erase(sections.begin() + idx);
+	invalidatePages();
 	setSectionIndex(0); //reload sections
 
 	string path = GMenu2X::getHome() + "/sections/" + sectionName;
@@ -554,6 +592,8 @@ bool Menu::moveSelectedLink(string const& newSection)
 	// Note: Get new index first, since it might move the selected index.
 	auto const newSectionIndex = sectionNamed(newSection);
 	auto const oldSectionIndex = iSection;
+	// Read the section before the link file gets moved there.
+	loadSection(newSectionIndex);
 
 	string const& file = linkApp->getFile();
 	string linkTitle = file.substr(file.rfind('/') + 1);
@@ -572,19 +612,17 @@ bool Menu::moveSelectedLink(string const& newSection)
 	}
 	linkApp->setFile(newFileName);
 
-	// Fetch sections.
-	auto& newSectionLinks = links[newSectionIndex];
-	auto& oldSectionLinks = links[oldSectionIndex];
-
 	// Move link.
+	auto& oldSectionLinks = links[oldSectionIndex];
 	auto it = oldSectionLinks.begin() + iLink;
 	auto link = it->release();
 	oldSectionLinks.erase(it);
-	newSectionLinks.emplace_back(link);
+	invalidatePages();
+	int newLinkIndex = insertLink(newSectionIndex, link);
 
 	// Select the same link in the new section.
 	setSectionIndex(newSectionIndex);
-	setLinkIndex(newSectionLinks.size() - 1);
+	setLinkIndex(newLinkIndex);
 
 	return true;
 }
@@ -678,12 +716,19 @@ void Menu::openPackagesFromDir(std::string const& path)
 	DEBUG("Opening packages from directory: %s\n", path.c_str());
 	if (readPackages(path)) {
 #ifdef ENABLE_INOTIFY
-		monitors.emplace_back(new Monitor(path.c_str(), this));
+		// The directories are read again after the FunKey menu was shown.
+		for (auto& monitor : monitors) {
+			if (monitor->getPath() == path) {
+				return;
+			}
+		}
+		monitors.emplace_back(new Monitor(path.c_str(), monitorQueue));
+		monitors.back()->start();
 #endif
 	}
 }
 
-void Menu::openPackage(std::string const& path, bool order)
+void Menu::openPackage(std::string const& path)
 {
 #ifdef ENABLE_INOTIFY
 	/* First try to remove existing links of the same OPK
@@ -691,11 +736,12 @@ void Menu::openPackage(std::string const& path, bool order)
 	removePackageLink(path);
 #endif
 
-	struct OPK *opk = opk_open(path.c_str());
-	if (!opk) {
-		ERROR("Unable to open OPK %s\n", path.c_str());
+	// Fresh, as libopk reads the meta-data files once per opened handle.
+	auto handle = OpkPool::open(path, true);
+	if (!handle) {
 		return;
 	}
+	struct OPK *opk = handle.get();
 
 	for (;;) {
 		bool has_metadata = false;
@@ -740,16 +786,22 @@ void Menu::openPackage(std::string const& path, bool order)
 		auto link = new LinkApp(gmenu2x, path, false, opk, name);
 		link->setSize(gmenu2x.skinConfInt["linkWidth"], gmenu2x.skinConfInt["linkHeight"]);
 
+		// The icon is only decoded when it is first drawn; extract it now,
+		// so that drawing it doesn't open the package again.
+		const string &icon = link->getIcon();
+		if (icon.size() > path.size() && icon.compare(0, path.size(), path) == 0
+				&& icon[path.size()] == '#') {
+			OpkPool::keepFile(handle, icon.substr(path.size() + 1));
+		}
+
 		auto idx = sectionNamed(link->getCategory());
-		links[idx].emplace_back(link);
+		insertLink(idx, link);
+#ifdef ENABLE_INOTIFY
+		packageLinks[path].push_back(link);
+#endif
 
 		createSectionDir(link->getCategory());
 	}
-
-	opk_close(opk);
-
-	if (order)
-		orderLinks();
 }
 
 bool Menu::readPackages(std::string const& parentDir)
@@ -776,11 +828,12 @@ bool Menu::readPackages(std::string const& parentDir)
 			continue;
 		}
 
-		openPackage(parentDir + '/' + dptr->d_name, false);
+		openPackage(parentDir + '/' + dptr->d_name);
 	}
 
 	closedir(dirp);
-	orderLinks();
+	// Don't keep the card busy once the scan is done.
+	OpkPool::release();
 
 	return true;
 }
@@ -791,29 +844,140 @@ bool Menu::readPackages(std::string const& parentDir)
  * correspond to an OPK present in the directory. */
 void Menu::removePackageLink(std::string const& path)
 {
-	for (auto section = links.begin(); section != links.end(); ++section) {
-		for (auto link = section->begin(); link != section->end(); ++link) {
-			LinkApp *app = dynamic_cast<LinkApp *>(link->get());
-			if (!app || !app->isOpk() || app->getOpkFile().empty())
-				continue;
-
-			if (app->getOpkFile().compare(0, path.size(), path) == 0) {
-				DEBUG("Removing link corresponding to package %s\n",
-							app->getOpkFile().c_str());
-				section->erase(link);
-				if (section - links.begin() == iSection
-							&& iLink == (int) section->size()) {
-					setLinkIndex(iLink - 1);
-				}
-				--link;
+	vector<string> packages;
+	if (packageLinks.count(path)) {
+		packages.push_back(path);
+	} else {
+		for (auto& package : packageLinks) {
+			if (package.first.compare(0, path.size(), path) == 0) {
+				packages.push_back(package.first);
 			}
 		}
 	}
 
+	for (auto& package : packages) {
+		DEBUG("Removing links corresponding to package %s\n",
+					package.c_str());
+		for (auto link : packageLinks[package]) {
+			LinkApp *app = static_cast<LinkApp *>(link);
+			// Never create a section just to remove a link from it.
+			int section = findSection(app->getCategory());
+			if (section >= 0) {
+				eraseLink(section, link);
+			}
+		}
+		packageLinks.erase(package);
+	}
+
+	OpkPool::close(path);
+
 	/* Remove registered monitors */
-	for (auto it = monitors.begin(); it < monitors.end(); ++it) {
+	for (auto it = monitors.begin(); it != monitors.end(); ) {
 		if ((*it)->getPath().compare(0, path.size(), path) == 0) {
-			monitors.erase(it);
+			it = monitors.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/** How long the monitors have to be quiet before OPK changes are applied. */
+static const uint32_t MONITOR_DEBOUNCE_MS = 500;
+
+void Menu::processMonitorEvents()
+{
+	for (auto& event : monitorQueue.take()) {
+		switch (event.type) {
+			case MonitorQueue::Type::PACKAGE_CHANGED:
+			case MonitorQueue::Type::PACKAGE_REMOVED:
+				changedPackages[event.path] =
+						event.type == MonitorQueue::Type::PACKAGE_CHANGED;
+				changedPackagesDeadline = SDL_GetTicks() + MONITOR_DEBOUNCE_MS;
+				break;
+
+			case MonitorQueue::Type::DIR_ADDED:
+				openPackagesFromDir(event.path);
+				break;
+
+			case MonitorQueue::Type::DIR_REMOVED:
+				// Pending changes of OPKs in that directory are moot now.
+				for (auto it = changedPackages.lower_bound(event.path);
+						it != changedPackages.end()
+						&& it->first.compare(0, event.path.size(), event.path) == 0; ) {
+					it = changedPackages.erase(it);
+				}
+				removePackageLink(event.path);
+				break;
+
+			case MonitorQueue::Type::DIR_RESCAN:
+				removeVanishedPackages(event.path);
+				break;
+		}
+	}
+
+	if (changedPackages.empty()) {
+		return;
+	}
+
+	int32_t remaining = (int32_t) (changedPackagesDeadline - SDL_GetTicks());
+	if (remaining > 0) {
+		debounceTimer.start(remaining);
+		return;
+	}
+
+	DEBUG("Applying %zu OPK changes\n", changedPackages.size());
+	for (auto& change : changedPackages) {
+		if (change.second) {
+			openPackage(change.first);
+		} else {
+			removePackageLink(change.first);
+		}
+	}
+	changedPackages.clear();
+	OpkPool::release();
+}
+
+void Menu::removeVanishedPackages(string const& dir)
+{
+	const string prefix = dir + '/';
+	auto isBelow = [&prefix](string const& path) {
+		return path.compare(0, prefix.size(), prefix) == 0;
+	};
+
+	vector<string> vanished;
+	for (auto& package : packageLinks) {
+		if (isBelow(package.first) && !fileExists(package.first)) {
+			vanished.push_back(package.first);
+		}
+	}
+	for (auto& package : vanished) {
+		removePackageLink(package);
+	}
+
+	for (auto it = monitors.begin(); it != monitors.end(); ) {
+		const string path = (*it)->getPath();
+		if ((path == dir || isBelow(path)) && !fileExists(path)) {
+			removePackageLink(path);
+			it = monitors.begin();
+		} else {
+			++it;
+		}
+	}
+}
+
+void Menu::unindexLink(Link *link)
+{
+	LinkApp *app = dynamic_cast<LinkApp *>(link);
+	if (!app || !app->isOpk()) {
+		return;
+	}
+
+	auto it = packageLinks.find(app->getOpkFile());
+	if (it != packageLinks.end()) {
+		auto& list = it->second;
+		list.erase(std::remove(list.begin(), list.end(), link), list.end());
+		if (list.empty()) {
+			packageLinks.erase(it);
 		}
 	}
 }
@@ -822,45 +986,255 @@ void Menu::removePackageLink(std::string const& path)
 
 static bool compare_links(unique_ptr<Link> const& a, unique_ptr<Link> const& b)
 {
-	LinkApp *app1 = dynamic_cast<LinkApp *>(a.get());
-	LinkApp *app2 = dynamic_cast<LinkApp *>(b.get());
-	bool app1_is_opk = app1 && app1->isOpk(),
-		 app2_is_opk = app2 && app2->isOpk();
+	return a->sortsBefore(*b);
+}
 
-	if (app1_is_opk && !app2_is_opk) {
-		return false;
+SDL_Rect Menu::linkArea()
+{
+	ConfIntHash &skinConfInt = gmenu2x.skinConfInt;
+	const int topBarHeight = skinConfInt["topBarHeight"];
+	const int linkHeight = skinConfInt["linkHeight"];
+	const int height = gmenu2x.height();
+	const int linkSpacingY = (height - 35 - topBarHeight - linkRows * linkHeight) / linkRows;
+
+	int bottom = min(topBarHeight + 2 + (int) linkRows * (linkHeight + linkSpacingY),
+			height);
+	return SDL_Rect {
+		0, static_cast<Sint16>(topBarHeight),
+		static_cast<Uint16>(gmenu2x.width()),
+		static_cast<Uint16>(max(bottom - topBarHeight, 0))
+	};
+}
+
+void Menu::layoutPage(int section, uint32_t firstRow)
+{
+	if (section == layoutSection && firstRow == layoutFirstRow) {
+		return;
 	}
-	if (app2_is_opk && !app1_is_opk) {
-		return true;
+	layoutSection = section;
+	layoutFirstRow = firstRow;
+
+	ConfIntHash &skinConfInt = gmenu2x.skinConfInt;
+	const int topBarHeight = skinConfInt["topBarHeight"];
+	const int linkWidth = skinConfInt["linkWidth"];
+	const int linkHeight = skinConfInt["linkHeight"];
+	const int width = gmenu2x.width(), height = gmenu2x.height();
+
+	auto& sectionLinks = links[section];
+	const uint32_t numLinks = sectionLinks.size();
+	const uint32_t linksPerPage = linkColumns * linkRows;
+	const int linkSpacingX = (width - 10 - linkColumns * linkWidth) / linkColumns;
+	const int linkMarginX = (
+			width - linkWidth * linkColumns - linkSpacingX * (linkColumns - 1)
+			) / 2;
+	const int linkSpacingY = (height - 35 - topBarHeight - linkRows * linkHeight) / linkRows;
+	for (uint32_t i = firstRow * linkColumns; i < firstRow * linkColumns + linksPerPage && i < numLinks; i++) {
+		const int ir = i - firstRow * linkColumns;
+		const int x = linkMarginX + (ir % linkColumns) * (linkWidth + linkSpacingX);
+		const int y = ir / linkColumns * (linkHeight + linkSpacingY) + topBarHeight + 2;
+		sectionLinks[i]->setPosition(x, y);
 	}
-	return a->getTitle().compare(b->getTitle()) < 0;
 }
 
-void Menu::orderLinks()
+/** How much memory the cached pages may take, in bytes. */
+static const size_t PAGE_CACHE_SIZE = 1024 * 1024;
+/** The displayed page and its two neighbours are always kept. */
+static const size_t MIN_CACHED_PAGES = 3;
+
+Surface &Menu::getPage(int section, uint32_t firstRow)
 {
-	for (auto& section : links) {
-		sort(section.begin(), section.end(), compare_links);
+	touchSection(section);
+	for (auto it = pages.begin(); it != pages.end(); ++it) {
+		if (it->section == section && it->firstRow == firstRow) {
+			pages.splice(pages.begin(), pages, it);
+			return *it->surface;
+		}
+	}
+
+	// Pages are copies of the background, which is as big as the screen.
+	auto& bg = *gmenu2x.bgmain;
+	SDL_Rect area = linkArea();
+	const size_t pageSize = bg.getSurface()->pitch * bg.height();
+	unique_ptr<OffscreenSurface> surface;
+	if (pages.size() >= MIN_CACHED_PAGES
+			&& pagesSize + pageSize > PAGE_CACHE_SIZE) {
+		// Recycle the least recently used page.
+		surface = std::move(pages.back().surface);
+		pages.pop_back();
+		bg.blitRegion(*surface, area, area.x, area.y);
+	} else {
+		surface.reset(new OffscreenSurface(bg));
+		surface->setUse(SurfaceUse::MENU_PAGE);
+		pagesSize += pageSize;
+		DEBUG("Cached pages take %zu bytes\n", pagesSize);
 	}
+
+	layoutPage(section, firstRow);
+	auto& sectionLinks = links[section];
+	const uint32_t end = min<uint32_t>(sectionLinks.size(),
+			(firstRow + linkRows) * linkColumns);
+	for (uint32_t i = firstRow * linkColumns; i < end; i++) {
+		sectionLinks[i]->paint(*surface);
+	}
+
+	pages.push_front(Page { section, firstRow, std::move(surface) });
+	return *pages.front().surface;
 }
 
-void Menu::readLinks()
+void Menu::invalidatePages()
 {
-	iLink = 0;
-	iFirstDispRow = 0;
+	pages.clear();
+	pagesSize = 0;
+	layoutSection = -1;
+}
 
-	for (size_t i=0; i<links.size(); i++) {
-		links[i].clear();
+void Menu::renderAdjacentPages()
+{
+	const int numSections = sections.size();
+	if (numSections > 1) {
+		getPage((iSection + numSections - 1) % numSections, 0);
+		getPage((iSection + 1) % numSections, 0);
+	}
+}
 
-		int correct = (i>sections.size() ? iSection : i);
-		string const& section = sections[correct];
+int Menu::insertLink(uint32_t section, Link *link)
+{
+	auto& sectionLinks = links[section];
+	auto it = upper_bound(sectionLinks.begin(), sectionLinks.end(), link,
+			[](Link *link, unique_ptr<Link> const& other) {
+				return link->sortsBefore(*other);
+			});
+	int idx = it - sectionLinks.begin();
+	sectionLinks.emplace(it, link);
+	invalidatePages();
+
+	// Keep the same link selected.
+	if ((int) section == iSection && idx <= iLink && sectionLinks.size() > 1) {
+		setLinkIndex(iLink + 1);
+	}
+	return idx;
+}
 
-		readLinksOfSection(
-				links[i], GMENU2X_SYSTEM_DIR "/sections/" + section, false);
-		readLinksOfSection(
-				links[i], GMenu2X::getHome() + "/sections/" + section, true);
+bool Menu::eraseLink(uint32_t section, Link *link)
+{
+	auto isLink = [link](unique_ptr<Link> const& other) {
+		return other.get() == link;
+	};
+
+	// The link is normally at its sorted place, unless it was renamed.
+	auto sectionLinks = &links[section];
+	auto it = lower_bound(sectionLinks->begin(), sectionLinks->end(), link,
+			[](unique_ptr<Link> const& other, Link *link) {
+				return other->sortsBefore(*link);
+			});
+	while (it != sectionLinks->end() && !isLink(*it)
+			&& !link->sortsBefore(**it)) {
+		++it;
 	}
+	if (it == sectionLinks->end() || !isLink(*it)) {
+		it = find_if(sectionLinks->begin(), sectionLinks->end(), isLink);
+	}
+	if (it == sectionLinks->end()) {
+		// The link was moved to another section.
+		for (section = 0; section < links.size(); section++) {
+			sectionLinks = &links[section];
+			it = find_if(sectionLinks->begin(), sectionLinks->end(), isLink);
+			if (it != sectionLinks->end()) {
+				break;
+			}
+		}
+		if (section == links.size()) {
+			return false;
+		}
+	}
+
+	int idx = it - sectionLinks->begin();
+	sectionLinks->erase(it);
+	invalidatePages();
+
+	// Keep the same link selected, or the previous one if it was removed.
+	if ((int) section == iSection
+			&& (idx < iLink || iLink == (int) sectionLinks->size())) {
+		setLinkIndex(max(iLink - 1, 0));
+	}
+	return true;
+}
 
-	orderLinks();
+void Menu::loadSection(uint32_t section)
+{
+	if (loadedSections[section]) {
+		return;
+	}
+	loadedSections[section] = true;
+
+	auto& sectionLinks = links[section];
+	string const& name = sections[section];
+	readLinksOfSection(
+			sectionLinks, GMENU2X_SYSTEM_DIR "/sections/" + name, false);
+	readLinksOfSection(
+			sectionLinks, GMenu2X::getHome() + "/sections/" + name, true);
+
+	Link *selected = (int) section == iSection ? selLink() : nullptr;
+	sort(sectionLinks.begin(), sectionLinks.end(), compare_links);
+	invalidatePages();
+
+	// Keep the same link selected.
+	if (selected) {
+		for (size_t i = 0; i < sectionLinks.size(); i++) {
+			if (sectionLinks[i].get() == selected) {
+				setLinkIndex(i);
+				break;
+			}
+		}
+	}
+}
+
+/** How many sections keep the surfaces of their links. */
+static const size_t RECENT_SECTIONS = 4;
+
+void Menu::touchSection(uint32_t section)
+{
+	loadSection(section);
+
+	string const& name = sections[section];
+	auto it = find(recentSections.begin(), recentSections.end(), name);
+	if (it != recentSections.end()) {
+		recentSections.splice(recentSections.begin(), recentSections, it);
+		return;
+	}
+	recentSections.push_front(name);
+	if (recentSections.size() <= RECENT_SECTIONS) {
+		return;
+	}
+
+	string oldName = recentSections.back();
+	recentSections.pop_back();
+	auto old = lower_bound(sections.begin(), sections.end(), oldName);
+	if (old == sections.end() || *old != oldName) {
+		// The section was deleted.
+		return;
+	}
+
+	DEBUG("Freeing the surfaces of section '%s'\n", oldName.c_str());
+	unordered_set<string> icons;
+	for (auto& link : links[old - sections.begin()]) {
+		if (link->hasIconSurface()) {
+			icons.insert(link->getIconPath());
+		}
+		link->freeSurfaces();
+	}
+
+	// Keep the icons that other links still point to.
+	for (auto& sectionLinks : links) {
+		for (auto& link : sectionLinks) {
+			if (link->hasIconSurface()) {
+				icons.erase(link->getIconPath());
+			}
+		}
+	}
+	for (auto& icon : icons) {
+		gmenu2x.sc.del(icon);
+	}
 }
 
 void Menu::readLinksOfSection(
@@ -21,13 +21,21 @@
 #ifndef MENU_H
 #define MENU_H
 
+#include "animation.h"
 #include "iconbutton.h"
 #include "layer.h"
 #include "link.h"
+#include "monitorqueue.h"
+#include "reactor.h"
+#include "utilities.h"
 
+#include <cstdint>
 #include <functional>
+#include <list>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class GMenu2X;
@@ -43,28 +51,70 @@ Handles the menu structure
 */
 class Menu : public Layer {
 private:
-	class Animation {
-	public:
-		Animation();
-		bool isRunning() { return curr != 0; }
-		int currentValue() { return curr; }
-		void adjust(int delta);
-		void step();
-	private:
-		int curr;
-	};
-
 	GMenu2X& gmenu2x;
 	IconButton btnContextMenu;
 	int iSection, iLink;
 	uint32_t iFirstDispRow;
 	std::vector<std::string> sections;
-	std::vector<std::unique_ptr<OffscreenSurface>> section_text_surfaces;
+
+	/**
+	 * What is drawn for each section in the top bar; updated when the
+	 * skin or the font changes.
+	 */
+	struct SectionHeader {
+		/** Owned by the surface collection. */
+		OffscreenSurface *icon;
+		std::unique_ptr<OffscreenSurface> label;
+	};
+	std::vector<SectionHeader> sectionHeaders;
 	std::vector<std::vector<std::unique_ptr<Link>>> links;
+	/**
+	 * Whether the link files of each section were read. Sections are only
+	 * read when they are first shown; OPKs and actions can be added to
+	 * a section before that.
+	 */
+	std::vector<bool> loadedSections;
+	/**
+	 * The names of the sections shown lately, most recent first.
+	 * The links of the other sections don't keep their surfaces.
+	 */
+	std::list<std::string> recentSections;
 
 	uint32_t linkColumns, linkRows;
 
+	/**
+	 * How far the sections are from their place, in 16.16 fixed point
+	 * sections; they slide back to it.
+	 */
 	Animation sectionAnimation;
+	void slideSections(int delta);
+
+	/**
+	 * The background with a page of links drawn over it, except for the
+	 * selection. Pages are only redrawn when their links change, so that
+	 * moving the selection doesn't repaint every link, and the pages of
+	 * the neighbouring sections are ready to slide in.
+	 */
+	struct Page {
+		int section;
+		uint32_t firstRow;
+		std::unique_ptr<OffscreenSurface> surface;
+	};
+	/** Most recently used first. */
+	std::list<Page> pages;
+	/** Memory taken by the pages, in bytes. */
+	size_t pagesSize;
+
+	/** The page whose links are at their place on screen. */
+	int layoutSection;
+	uint32_t layoutFirstRow;
+
+	/** Returns the area of the screen that the link grid can cover. */
+	SDL_Rect linkArea();
+	/** Moves the links of the given page to their place on screen. */
+	void layoutPage(int section, uint32_t firstRow);
+	/** Returns the given page, rendering it if it isn't cached. */
+	Surface &getPage(int section, uint32_t firstRow);
 
 	/**
 	 * Determine which section headers are visible.
@@ -72,20 +122,66 @@ private:
 	 */
 	void calcSectionRange(int &leftSection, int &rightSection);
 
-	void readLinks();
-	void freeLinks();
+	/** Returns the index of the section, or -1 if there is none. */
+	int findSection(std::string const& sectionName) const;
+	/** Reads the link files of the section, unless done already. */
+	void loadSection(uint32_t section);
+	/**
+	 * Marks the section as shown. If this pushes a section out of the
+	 * recent ones, the surfaces of its links are freed.
+	 */
+	void touchSection(uint32_t section);
 
-	// Load all the sections of the given "sections" directory.
+	/**
+	 * Load all the sections of the given "sections" directory.
+	 * The sections are added in order, so each one goes to the end.
+	 */
 	void readSections(std::string const& parentDir);
 
 #ifdef HAVE_LIBOPK
 	// Load all the .opk packages of the given directory
 	bool readPackages(std::string const& parentDir);
 #ifdef ENABLE_INOTIFY
+	// Declared before the monitors, which push into it until destroyed.
+	MonitorQueue monitorQueue;
 	std::vector<std::unique_ptr<Monitor>> monitors;
+
+	/**
+	 * OPKs changed on disk but not reloaded yet: true if the OPK was
+	 * added or modified, false if it was removed.
+	 * Changes are applied once the monitors have been quiet for a while,
+	 * so copying many OPKs to the card results in one reload.
+	 */
+	std::map<std::string, bool> changedPackages;
+	uint32_t changedPackagesDeadline;
+	/** Wakes up the main loop to apply the changes. */
+	Reactor::Timer debounceTimer { request_repaint };
+
+	/** The links created from each OPK, so they can be found quickly. */
+	std::unordered_map<std::string, std::vector<Link *>> packageLinks;
+
+	void processMonitorEvents();
+	/**
+	 * Removes the links of the OPKs below 'dir' that no longer exist, and
+	 * the monitors of directories there that are gone.
+	 */
+	void removeVanishedPackages(std::string const& dir);
+	/** Drops the link from the OPK index, before it gets deleted. */
+	void unindexLink(Link *link);
 #endif
 #endif
 
+	/**
+	 * Inserts the link at its place in the sorted section.
+	 * @return The index of the link in the section.
+	 */
+	int insertLink(uint32_t section, Link *link);
+	/**
+	 * Deletes the link, looking for it in the given section first.
+	 * @return True iff the link was found.
+	 */
+	bool eraseLink(uint32_t section, Link *link);
+
 	// Load all the links on the given section directory.
 	void readLinksOfSection(std::vector<std::unique_ptr<Link>>& links,
 							std::string const& path, bool deletable);
@@ -104,7 +200,7 @@ private:
 	void linkUp();
 	void linkDown();
 
-	void updateSectionTextSurfaces();
+	void updateSectionHeader(uint32_t section);
 public:
 	typedef std::function<void(void)> Action;
 
@@ -112,10 +208,12 @@ public:
 	virtual ~Menu();
 
 #ifdef HAVE_LIBOPK
-	void openPackage(std::string const& path, bool order = true);
+	void openPackage(std::string const& path);
 	void openPackagesFromDir(std::string const& path);
 #ifdef ENABLE_INOTIFY
 	void removePackageLink(std::string const& path);
+
+	MonitorQueue &getMonitorQueue() { return monitorQueue; }
 #endif
 #endif
 
@@ -150,13 +248,23 @@ public:
 
 	// Called when the font has changed but not when it is loaded for the first time.
 	void fontChanged();
-	
-	void orderLinks();
+
+	/**
+	 * Drops the rendered pages, so that they are drawn again.
+	 * Needed when a link or the background changed behind our back.
+	 */
+	void invalidatePages();
+	/**
+	 * Renders the pages of the neighbouring sections ahead of time,
+	 * so that switching sections can slide them in right away.
+	 */
+	void renderAdjacentPages();
 
 	// Layer implementation:
 	virtual bool runAnimations();
 	virtual void paint(Surface &s);
 	virtual bool handleButtonPress(InputManager::Button button);
+	virtual const char *getName() { return "menu"; }
 
 	int selLinkIndex();
 	Link *selLink();
@@ -20,6 +20,7 @@
 
 #include "messagebox.h"
 #include "gmenu2x.h"
+#include "latency.h"
 #include "surface.h"
 
 #include <chrono>
@@ -65,6 +66,7 @@ void MessageBox::setButton(InputManager::Button button, const string &label) {
 }
 
 int MessageBox::exec() {
+	InputLatency::Context latency("message box");
 	OutputSurface& s = *gmenu2x.s;
 	OffscreenSurface bg(s);
 	//Darken background
@@ -0,0 +1,124 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "mixer.h"
+
+#include "debug.h"
+
+#ifdef HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+using namespace std;
+
+#ifdef HAVE_ALSA
+
+Mixer::Mixer(string const& element)
+	: handle(nullptr)
+	, elem(nullptr)
+	, min(0)
+	, max(0)
+{
+	int err = snd_mixer_open(&handle, 0);
+	if (err < 0) {
+		WARNING("Unable to open mixer: %s\n", snd_strerror(err));
+		handle = nullptr;
+		return;
+	}
+
+	if ((err = snd_mixer_attach(handle, "default")) < 0
+			|| (err = snd_mixer_selem_register(handle, nullptr, nullptr)) < 0
+			|| (err = snd_mixer_load(handle)) < 0) {
+		WARNING("Unable to load mixer: %s\n", snd_strerror(err));
+		snd_mixer_close(handle);
+		handle = nullptr;
+		return;
+	}
+
+	snd_mixer_selem_id_t *sid;
+	snd_mixer_selem_id_alloca(&sid);
+	snd_mixer_selem_id_set_index(sid, 0);
+	snd_mixer_selem_id_set_name(sid, element.c_str());
+
+	snd_mixer_elem_t *found = snd_mixer_find_selem(handle, sid);
+	if (!found || !snd_mixer_selem_has_playback_volume(found)) {
+		WARNING("No playback volume control '%s'\n", element.c_str());
+		return;
+	}
+
+	snd_mixer_selem_get_playback_volume_range(found, &min, &max);
+	if (max > min) {
+		elem = found;
+	}
+}
+
+Mixer::~Mixer()
+{
+	if (handle) {
+		snd_mixer_close(handle);
+	}
+}
+
+bool Mixer::available() const
+{
+	return elem != nullptr;
+}
+
+int Mixer::getVolume()
+{
+	if (!elem) {
+		return -1;
+	}
+
+	// Pick up changes made by others since the mixer was loaded.
+	snd_mixer_handle_events(handle);
+
+	long value;
+	if (snd_mixer_selem_get_playback_volume(
+				elem, SND_MIXER_SCHN_FRONT_LEFT, &value) < 0) {
+		return -1;
+	}
+	return ((value - min) * 100 + (max - min) / 2) / (max - min);
+}
+
+bool Mixer::setVolume(int percent)
+{
+	if (!elem) {
+		return false;
+	}
+
+	long value = min + ((max - min) * percent + 50) / 100;
+	int err = snd_mixer_selem_set_playback_volume_all(elem, value);
+	if (err < 0) {
+		WARNING("Unable to set volume: %s\n", snd_strerror(err));
+		return false;
+	}
+	return true;
+}
+
+#else // HAVE_ALSA
+
+Mixer::Mixer(string const&)
+{
+}
+
+Mixer::~Mixer()
+{
+}
+
+bool Mixer::available() const
+{
+	return false;
+}
+
+int Mixer::getVolume()
+{
+	return -1;
+}
+
+bool Mixer::setVolume(int)
+{
+	return false;
+}
+
+#endif // HAVE_ALSA
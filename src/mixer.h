@@ -0,0 +1,39 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __MIXER_H__
+#define __MIXER_H__
+
+#include <string>
+
+#ifdef HAVE_ALSA
+typedef struct _snd_mixer snd_mixer_t;
+typedef struct _snd_mixer_elem snd_mixer_elem_t;
+#endif
+
+/**
+ * Direct access to a playback volume control of the default ALSA card.
+ * Without ALSA support, or if the control doesn't exist, the mixer is not
+ * available and the volume has to be set some other way.
+ */
+class Mixer {
+public:
+	Mixer(std::string const& element);
+	~Mixer();
+
+	bool available() const;
+
+	/** Returns the volume in percent, or -1 on error. */
+	int getVolume();
+
+	bool setVolume(int percent);
+
+private:
+#ifdef HAVE_ALSA
+	snd_mixer_t *handle;
+	snd_mixer_elem_t *elem;
+	long min, max;
+#endif
+};
+
+#endif // __MIXER_H__
@@ -1,97 +1,513 @@
 #ifdef ENABLE_INOTIFY
 #include "debug.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <climits>
+#include <cstring>
 #include <dirent.h>
-#include <pthread.h>
-#include <SDL.h>
-#include <signal.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sstream>
+#include <sys/epoll.h>
 #include <sys/inotify.h>
+#include <thread>
 #include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-#include "inputmanager.h"
-#include "menu.h"
 #include "monitor.h"
-#include "utilities.h"
+#include "monitorqueue.h"
 
-void Monitor::inject_event(bool is_add, const char *path)
-{
-	if (is_add)
-		menu->openPackage(path);
-	else
-		menu->removePackageLink(path);
+using namespace std;
+
+/**
+ * The thread behind all monitors: it owns one inotify instance holding the
+ * watches of every monitor, and also follows the mount table.
+ * The handlers of the monitors are called with the lock held, so removing
+ * a monitor waits for its handlers to finish.
+ */
+class Watcher {
+public:
+	/** Started on first use and never destroyed: its thread is detached. */
+	static Watcher &instance();
+
+	void add(Monitor *monitor);
+	void remove(Monitor *monitor);
+
+	/** Only called by handlers, on the watcher thread. */
+	void waitForMount(Monitor *monitor, string const& path, int timeout);
+
+private:
+	struct Watch {
+		Monitor *monitor;
+		string dir;
+	};
+
+	struct PendingMount {
+		Monitor *monitor;
+		string path;
+		chrono::steady_clock::time_point deadline;
+	};
+
+	Watcher();
 
-	request_repaint();
+	void run();
+	/**
+	 * Watches 'dir' for the monitor, and its subdirectories if the monitor
+	 * is recursive. If 'report' is set, the files found in subdirectories
+	 * are reported as if they had just been moved in.
+	 */
+	void addWatches(Monitor *monitor, string const& dir, bool report);
+	bool addWatch(Monitor *monitor, string const& dir);
+	/** Stops watching a subdirectory of a recursive monitor, and below. */
+	void removeWatches(Monitor *monitor, string const& dir);
+	void readEvents();
+	void readMounts();
+	int checkMounts();
+
+	mutex lock;
+	int inotifyFd, mountFd, epollFd;
+	vector<Monitor *> monitors;
+	/** The monitors of each watched directory. */
+	unordered_map<int, vector<Watch>> watches;
+	unordered_set<string> mountPoints;
+	vector<PendingMount> pendingMounts;
+};
+
+Watcher &Watcher::instance()
+{
+	static Watcher *watcher = new Watcher;
+	return *watcher;
 }
 
-bool Monitor::event_accepted(struct inotify_event &event)
+Watcher::Watcher()
+	: mountFd(-1)
+	, epollFd(-1)
 {
-	/* Don't bother other files than OPKs */
-	size_t len = strlen(event.name);
-	return len >= 5 && !strncmp(event.name + len - 4, ".opk", 4);
+	inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (inotifyFd < 0) {
+		ERROR("Unable to start inotify\n");
+		return;
+	}
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd < 0) {
+		ERROR("Unable to create epoll instance: %s\n", strerror(errno));
+		close(inotifyFd);
+		inotifyFd = -1;
+		return;
+	}
+
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = inotifyFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, inotifyFd, &event);
+
+	// The mount table signals changes with EPOLLPRI.
+	mountFd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+	if (mountFd < 0) {
+		WARNING("Unable to open mount table: %s\n", strerror(errno));
+	} else {
+		event.events = EPOLLPRI;
+		event.data.fd = mountFd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, mountFd, &event);
+		readMounts();
+	}
+
+	thread(&Watcher::run, this).detach();
 }
 
-int Monitor::run()
+void Watcher::add(Monitor *monitor)
 {
-	DEBUG("Starting inotify thread for path %s...\n", path.c_str());
+	if (inotifyFd < 0) {
+		return;
+	}
 
-	int fd = inotify_init1(IN_CLOEXEC);
-	if (fd < 0) {
-		ERROR("Unable to start inotify\n");
-		return fd;
+	lock_guard<mutex> guard(lock);
+	monitors.push_back(monitor);
+	addWatches(monitor, monitor->path, false);
+}
+
+bool Watcher::addWatch(Monitor *monitor, string const& dir)
+{
+	// Watches are shared by all monitors of a directory, so only add to
+	// the events it reports; each monitor filters out what it didn't ask.
+	unsigned int mask = monitor->mask | IN_MASK_ADD;
+	if (monitor->recursive) {
+		mask |= IN_CREATE | IN_MOVE | IN_DELETE | IN_DELETE_SELF;
 	}
 
-	int wd = inotify_add_watch(fd, path.c_str(), mask);
+	int wd = inotify_add_watch(inotifyFd, dir.c_str(), mask);
 	if (wd < 0) {
 		ERROR("Unable to add inotify watch on '%s': %s\n",
-				path.c_str(), strerror(errno));
-		close(fd);
-		return wd;
+				dir.c_str(), strerror(errno));
+		return false;
+	}
+	DEBUG("Starting watching directory %s\n", dir.c_str());
+
+	// Watching a directory again, e.g. after a rescan, returns the same wd.
+	auto& list = watches[wd];
+	for (auto& watch : list) {
+		if (watch.monitor == monitor) {
+			watch.dir = dir;
+			return true;
+		}
+	}
+	list.push_back({ monitor, dir });
+	return true;
+}
+
+void Watcher::addWatches(Monitor *monitor, string const& dir, bool report)
+{
+	vector<string> pending { dir };
+	while (!pending.empty()) {
+		const string current = move(pending.back());
+		pending.pop_back();
+		if (!addWatch(monitor, current) || !monitor->recursive) {
+			continue;
+		}
+
+		DIR *dirp = opendir(current.c_str());
+		if (!dirp) {
+			continue;
+		}
+		while (struct dirent *dptr = readdir(dirp)) {
+			if (!strcmp(dptr->d_name, ".") || !strcmp(dptr->d_name, "..")) {
+				continue;
+			}
+			if (dptr->d_type == DT_DIR) {
+				pending.push_back(current + '/' + dptr->d_name);
+			} else if (report && (monitor->mask & IN_MOVED_TO)) {
+				// Files that arrived before the watch made no event.
+				alignas(struct inotify_event)
+						char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
+				auto event = reinterpret_cast<struct inotify_event *>(buf);
+				event->wd = -1;
+				event->mask = IN_MOVED_TO;
+				event->cookie = 0;
+				event->len = strlen(dptr->d_name) + 1;
+				memcpy(event->name, dptr->d_name, event->len);
+				monitor->handle_event(*event, current);
+			}
+		}
+		closedir(dirp);
+	}
+}
+
+void Watcher::removeWatches(Monitor *monitor, string const& dir)
+{
+	const string prefix = dir + '/';
+	for (auto it = watches.begin(); it != watches.end(); ) {
+		auto& list = it->second;
+		list.erase(std::remove_if(list.begin(), list.end(),
+				[&](Watch const& watch) {
+					return watch.monitor == monitor
+							&& (watch.dir == dir
+								|| watch.dir.compare(0, prefix.size(), prefix) == 0);
+				}), list.end());
+		if (list.empty()) {
+			inotify_rm_watch(inotifyFd, it->first);
+			it = watches.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void Watcher::remove(Monitor *monitor)
+{
+	if (inotifyFd < 0) {
+		return;
+	}
+
+	lock_guard<mutex> guard(lock);
+	for (auto it = watches.begin(); it != watches.end(); ) {
+		auto& list = it->second;
+		list.erase(std::remove_if(list.begin(), list.end(),
+				[monitor](Watch const& watch) {
+					return watch.monitor == monitor;
+				}), list.end());
+		if (list.empty()) {
+			inotify_rm_watch(inotifyFd, it->first);
+			it = watches.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	for (auto it = pendingMounts.begin(); it != pendingMounts.end(); ) {
+		if (it->monitor == monitor) {
+			it = pendingMounts.erase(it);
+		} else {
+			++it;
+		}
 	}
 
-	DEBUG("Starting watching directory %s\n", path.c_str());
+	for (auto it = monitors.begin(); it != monitors.end(); ++it) {
+		if (*it == monitor) {
+			monitors.erase(it);
+			break;
+		}
+	}
+}
+
+void Watcher::waitForMount(Monitor *monitor, string const& path, int timeout)
+{
+	if (mountPoints.count(path)) {
+		monitor->mount_ready(path.c_str(), true);
+		return;
+	}
+	pendingMounts.push_back({ monitor, path,
+			chrono::steady_clock::now() + chrono::milliseconds(timeout) });
+}
 
+void Watcher::run()
+{
 	for (;;) {
-		size_t len = sizeof(struct inotify_event) + NAME_MAX + 1;
-		struct inotify_event event;
-		char buf[256];
+		int timeout;
+		{
+			lock_guard<mutex> guard(lock);
+			timeout = checkMounts();
+		}
+
+		struct epoll_event events[2];
+		int n = epoll_wait(epollFd, events, 2, timeout);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ERROR("Watcher stopped: %s\n", strerror(errno));
+			return;
+		}
 
-		read(fd, &event, len);
+		lock_guard<mutex> guard(lock);
+		for (int i = 0; i < n; i++) {
+			if (events[i].data.fd == inotifyFd) {
+				readEvents();
+			} else if (events[i].data.fd == mountFd) {
+				readMounts();
+			}
+		}
+	}
+}
 
-		if (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
-			inject_event(false, path.c_str());
+void Watcher::readEvents()
+{
+	alignas(struct inotify_event) char buf[4096];
+	for (;;) {
+		ssize_t len = read(inotifyFd, buf, sizeof(buf));
+		if (len <= 0) {
+			if (len < 0 && errno == EINTR) {
+				continue;
+			}
 			break;
 		}
 
-		sprintf(buf, "%s/%s", path.c_str(), event.name);
+		for (char *ptr = buf; ptr < buf + len; ) {
+			auto event = reinterpret_cast<struct inotify_event *>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				WARNING("inotify queue overflow\n");
+				for (auto monitor : monitors) {
+					monitor->rescan();
+					// Subdirectories may have come and gone meanwhile.
+					if (monitor->recursive) {
+						addWatches(monitor, monitor->path, true);
+					}
+				}
+				continue;
+			}
+
+			auto it = watches.find(event->wd);
+			if (it == watches.end()) {
+				continue;
+			}
+			if (event->mask & IN_IGNORED) {
+				watches.erase(it);
+				continue;
+			}
+
+			// Adding or removing watches may rehash the map.
+			vector<Watch> list = it->second;
+			for (auto& watch : list) {
+				Monitor *monitor = watch.monitor;
+				if (monitor->recursive && event->len
+						&& (event->mask & IN_ISDIR)) {
+					const string sub = watch.dir + '/' + event->name;
+					if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+						addWatches(monitor, sub, true);
+					} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+						removeWatches(monitor, sub);
+					}
+				}
+				if (event->mask & monitor->mask) {
+					monitor->handle_event(*event, watch.dir);
+				}
+			}
+
+			// A deleted subdirectory was reported by its parent already;
+			// the monitor's own directory is left to its owner.
+			if (event->mask & IN_DELETE_SELF) {
+				for (auto& watch : list) {
+					if (watch.monitor->recursive
+							&& watch.dir != watch.monitor->path) {
+						removeWatches(watch.monitor, watch.dir);
+					}
+				}
+			}
+		}
+	}
+}
+
+/** Undoes the octal escapes of spaces and such in /proc/self/mountinfo. */
+static string unescapeMountPath(string const& field)
+{
+	auto isOctal = [](char c) { return c >= '0' && c <= '7'; };
+
+	string path;
+	for (size_t i = 0; i < field.size(); i++) {
+		if (field[i] == '\\' && i + 3 < field.size()
+				&& isOctal(field[i + 1]) && isOctal(field[i + 2])
+				&& isOctal(field[i + 3])) {
+			path += (char) ((field[i + 1] - '0') * 64
+					+ (field[i + 2] - '0') * 8 + (field[i + 3] - '0'));
+			i += 3;
+		} else {
+			path += field[i];
+		}
+	}
+	return path;
+}
+
+void Watcher::readMounts()
+{
+	// Reading the file from the start also clears the change notification.
+	string info;
+	char buf[1024];
+	ssize_t n;
+	lseek(mountFd, 0, SEEK_SET);
+	while ((n = read(mountFd, buf, sizeof(buf))) > 0
+			|| (n < 0 && errno == EINTR)) {
+		if (n > 0) info.append(buf, n);
+	}
+
+	mountPoints.clear();
+	istringstream lines(info);
+	string line;
+	while (getline(lines, line)) {
+		// Fields: mount ID, parent ID, major:minor, root, mount point, ...
+		istringstream fields(line);
+		string id, parent, device, root, mountPoint;
+		if (fields >> id >> parent >> device >> root >> mountPoint) {
+			mountPoints.insert(unescapeMountPath(mountPoint));
+		}
+	}
+}
+
+/**
+ * Reports the pending mounts that are done or timed out, and returns the
+ * number of milliseconds until the next one times out, or -1.
+ */
+int Watcher::checkMounts()
+{
+	auto now = chrono::steady_clock::now();
+	int timeout = -1;
 
-		if (!event_accepted(event))
+	for (auto it = pendingMounts.begin(); it != pendingMounts.end(); ) {
+		bool mounted = mountPoints.count(it->path) != 0;
+		if (mounted || it->deadline <= now) {
+			PendingMount pending = *it;
+			it = pendingMounts.erase(it);
+			pending.monitor->mount_ready(pending.path.c_str(), mounted);
+			// The handler may have added pending mounts.
+			it = pendingMounts.begin();
 			continue;
+		}
 
-		inject_event(event.mask & (IN_MOVED_TO | IN_CLOSE_WRITE | IN_CREATE), buf);
+		int remaining = (int) chrono::duration_cast<chrono::milliseconds>(
+				it->deadline - now).count() + 1;
+		if (timeout < 0 || remaining < timeout) {
+			timeout = remaining;
+		}
+		++it;
 	}
 
-	return 0;
+	return timeout;
+}
+
+void Monitor::inject_event(bool is_add, const char *path)
+{
+	queue.push(is_add ? MonitorQueue::Type::PACKAGE_CHANGED
+			  : MonitorQueue::Type::PACKAGE_REMOVED, path);
+}
+
+bool Monitor::event_accepted(struct inotify_event &event)
+{
+	/* Don't bother other files than OPKs */
+	size_t len = strlen(event.name);
+	return len >= 5 && !strncmp(event.name + len - 4, ".opk", 4);
+}
+
+void Monitor::rescan()
+{
+	queue.push(MonitorQueue::Type::DIR_RESCAN, path);
+	queue.push(MonitorQueue::Type::DIR_ADDED, path);
+}
+
+void Monitor::wait_for_mount(std::string const& path, int timeout)
+{
+	Watcher::instance().waitForMount(this, path, timeout);
+}
+
+void Monitor::mount_ready(const char *path, bool /*mounted*/)
+{
+	queue.push(MonitorQueue::Type::DIR_ADDED, path);
+}
+
+void Monitor::handle_event(struct inotify_event &event, std::string const& dir)
+{
+	if (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+		// Subdirectories of recursive monitors are reported by their parent.
+		if (dir == path) {
+			queue.push(MonitorQueue::Type::DIR_REMOVED, path);
+		}
+		return;
+	}
+
+	if (recursive && event.len && (event.mask & IN_ISDIR)) {
+		// The OPKs of a subdirectory that went away go with it.
+		if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+			queue.push(MonitorQueue::Type::DIR_REMOVED,
+					dir + '/' + event.name);
+		}
+		return;
+	}
+
+	if (!event.len || !event_accepted(event))
+		return;
+
+	inject_event(event.mask & (IN_MOVED_TO | IN_CLOSE_WRITE | IN_CREATE),
+			(dir + '/' + event.name).c_str());
 }
 
-static void * inotify_thd(void *p)
+Monitor::Monitor(std::string path, MonitorQueue &queue, unsigned int flags,
+		bool recursive)
+	: path(path), queue(queue), mask(flags), recursive(recursive)
 {
-	Monitor *monitor = (Monitor *) p;
-	monitor->run();
-	return NULL;
 }
 
-Monitor::Monitor(std::string path, Menu *menu, unsigned int flags)
-	: path(path), menu(menu)
+void Monitor::start()
 {
-	mask = flags;
-	pthread_create(&thd, NULL, inotify_thd, (void *) this);
+	Watcher::instance().add(this);
 }
 
 Monitor::~Monitor()
 {
-	pthread_cancel(thd);
-	pthread_join(thd, NULL);
-	DEBUG("Monitor thread stopped (was watching %s)\n", path.c_str());
+	Watcher::instance().remove(this);
+	DEBUG("Monitor stopped (was watching %s)\n", path.c_str());
 }
 #endif
@@ -2,32 +2,71 @@
 #define __MONITOR_H__
 #ifdef ENABLE_INOTIFY
 
-#include <pthread.h>
 #include <string>
 #include <sys/inotify.h>
 
-class Menu;
+class MonitorQueue;
 
+/**
+ * Watches a directory for OPK changes and reports them to the UI thread
+ * through a MonitorQueue.
+ * All monitors share a single watcher thread and inotify instance, so
+ * creating a monitor costs a watch descriptor, not a thread.
+ * The event handlers below run on the watcher thread.
+ */
 class Monitor {
 public:
-	Monitor(std::string path, Menu *menu,
+	/**
+	 * Prepares to watch 'path'. If 'recursive' is set, the subdirectories
+	 * are watched as well, including the ones created or moved in later.
+	 */
+	Monitor(std::string path, MonitorQueue &queue,
 		unsigned int flags = IN_MOVE |
 		IN_CLOSE_WRITE | IN_DELETE | IN_CREATE |
-		IN_DELETE_SELF | IN_MOVE_SELF);
+		IN_DELETE_SELF | IN_MOVE_SELF,
+		bool recursive = false);
+	/** Stops watching; no handler runs anymore once this returns. */
 	virtual ~Monitor();
 
-	int run();
+	/**
+	 * Starts watching. This is not done by the constructor because the
+	 * handlers may run right away, and they are virtual.
+	 */
+	void start();
+
 	const std::string getPath() { return path; }
 
 private:
+	friend class Watcher;
+
 	std::string path;
-	pthread_t thd;
+
+	/**
+	 * Called by the watcher for each event in a watched directory: 'path'
+	 * or, for recursive monitors, one of its subdirectories.
+	 */
+	void handle_event(struct inotify_event &event, std::string const& dir);
 
 protected:
-	Menu *menu;
+	MonitorQueue &queue;
 	unsigned int mask;
+	bool recursive;
+
 	virtual bool event_accepted(struct inotify_event &event);
 	virtual void inject_event(bool is_add, const char *path);
+
+	/**
+	 * Called when the kernel dropped events, so the state of the watched
+	 * directory has to be read again.
+	 */
+	virtual void rescan();
+
+	/**
+	 * Asks the watcher to call mount_ready() once 'path' is a mount point,
+	 * or after 'timeout' milliseconds if it doesn't become one.
+	 */
+	void wait_for_mount(std::string const& path, int timeout);
+	virtual void mount_ready(const char *path, bool mounted);
 };
 
 #endif
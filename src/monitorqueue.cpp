@@ -0,0 +1,54 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifdef ENABLE_INOTIFY
+#include "monitorqueue.h"
+
+#include "utilities.h"
+
+#include <algorithm>
+
+using namespace std;
+
+MonitorQueue::MonitorQueue()
+	: head(nullptr)
+{
+}
+
+MonitorQueue::~MonitorQueue()
+{
+	take();
+}
+
+void MonitorQueue::push(Type type, string path)
+{
+	// Once published, the node belongs to the UI thread: don't touch it.
+	Node *node = new Node { { type, move(path) }, nullptr };
+	Node *next = head.load(memory_order_relaxed);
+	do {
+		node->next = next;
+	} while (!head.compare_exchange_weak(next, node,
+			memory_order_release, memory_order_relaxed));
+
+	// The UI thread wakes up for the first event and then takes everything
+	// that arrived meanwhile, so a burst doesn't flood the SDL event queue.
+	if (!next) {
+		request_repaint();
+	}
+}
+
+vector<MonitorQueue::Event> MonitorQueue::take()
+{
+	vector<Event> events;
+	Node *node = head.exchange(nullptr, memory_order_acquire);
+	while (node) {
+		Node *next = node->next;
+		events.push_back(move(node->event));
+		delete node;
+		node = next;
+	}
+	reverse(events.begin(), events.end());
+	return events;
+}
+
+#endif // ENABLE_INOTIFY
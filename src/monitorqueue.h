@@ -0,0 +1,65 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __MONITORQUEUE_H__
+#define __MONITORQUEUE_H__
+#ifdef ENABLE_INOTIFY
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * Carries file system changes from the monitor threads to the UI thread,
+ * which is the only one allowed to touch the menu.
+ * Any number of threads can push events without taking a lock; the UI
+ * thread takes all pending events at once.
+ */
+class MonitorQueue {
+public:
+	enum class Type {
+		/** An OPK was created, written or moved in. */
+		PACKAGE_CHANGED,
+		/** An OPK was deleted or moved away. */
+		PACKAGE_REMOVED,
+		/** A directory to look for OPKs in appeared, e.g. a mounted card. */
+		DIR_ADDED,
+		/** A directory went away, along with all the OPKs inside. */
+		DIR_REMOVED,
+		/**
+		 * Changes below a directory were lost: the OPKs there that no
+		 * longer exist have to be dropped. The directories to read again
+		 * follow as DIR_ADDED events.
+		 */
+		DIR_RESCAN,
+	};
+
+	struct Event {
+		Type type;
+		std::string path;
+	};
+
+	MonitorQueue();
+	~MonitorQueue();
+
+	/**
+	 * Adds an event to the queue. If the queue was empty, a repaint is
+	 * requested so that the main loop wakes up and handles it.
+	 */
+	void push(Type type, std::string path);
+
+	/** Removes all pending events and returns them, oldest first. */
+	std::vector<Event> take();
+
+private:
+	struct Node {
+		Event event;
+		Node *next;
+	};
+
+	/** Newest event first. */
+	std::atomic<Node *> head;
+};
+
+#endif // ENABLE_INOTIFY
+#endif // __MONITORQUEUE_H__
@@ -0,0 +1,169 @@
+#ifdef HAVE_LIBOPK
+#include "opkpool.h"
+
+#include "debug.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <opk.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/** Number of packages kept open. */
+static const size_t POOL_SIZE = 8;
+
+class OpkPool::Package {
+public:
+	Package(string const& path, struct OPK *opk) : path(path), opk(opk) {}
+	~Package() { opk_close(opk); }
+
+	const string path;
+	struct OPK *const opk;
+	recursive_mutex mutex;
+};
+
+static mutex poolMutex;
+/** Most recently used first. */
+static list<shared_ptr<OpkPool::Package>> pool;
+/** Files kept with keepFile(), by package path, '#' and file name. */
+static unordered_map<string, vector<char>> keptFiles;
+
+OpkPool::Handle::Handle(shared_ptr<Package> package)
+	: package(move(package))
+	, lock(this->package->mutex)
+{
+}
+
+struct OPK *OpkPool::Handle::get() const
+{
+	return package ? package->opk : nullptr;
+}
+
+int OpkPool::Handle::extractFile(
+		const char *name, void **data, size_t *length) const
+{
+	if (!package) return -1;
+	return opk_extract_file(package->opk, name, data, length);
+}
+
+OpkPool::Handle OpkPool::open(string const& path, bool fresh)
+{
+	shared_ptr<Package> package;
+	{
+		lock_guard<mutex> lock(poolMutex);
+
+		for (auto it = pool.begin(); it != pool.end(); ++it) {
+			if ((*it)->path == path) {
+				if (!fresh) {
+					package = *it;
+				}
+				pool.erase(it);
+				break;
+			}
+		}
+
+		if (!package) {
+			struct OPK *opk = opk_open(path.c_str());
+			if (!opk) {
+				ERROR("Unable to open OPK %s\n", path.c_str());
+				return Handle();
+			}
+			package = make_shared<Package>(path, opk);
+		}
+
+		pool.push_front(package);
+		if (pool.size() > POOL_SIZE) {
+			pool.pop_back();
+		}
+	}
+
+	// Lock outside of the pool lock, as this may wait for another thread.
+	return Handle(move(package));
+}
+
+void OpkPool::close(string const& path)
+{
+	lock_guard<mutex> lock(poolMutex);
+	pool.remove_if([&path](shared_ptr<Package> const& package) {
+		return package->path.compare(0, path.size(), path) == 0;
+	});
+	for (auto it = keptFiles.begin(); it != keptFiles.end(); ) {
+		if (it->first.compare(0, path.size(), path) == 0) {
+			it = keptFiles.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void OpkPool::release()
+{
+	lock_guard<mutex> lock(poolMutex);
+	pool.clear();
+}
+
+void OpkPool::keepFile(Handle const& handle, string const& name)
+{
+	if (!handle) return;
+	const string key = handle.package->path + '#' + name;
+	{
+		lock_guard<mutex> lock(poolMutex);
+		if (keptFiles.count(key)) return;
+	}
+
+	void *data;
+	size_t length;
+	if (handle.extractFile(name.c_str(), &data, &length) < 0) {
+		WARNING("Unable to extract %s from OPK %s\n",
+				name.c_str(), handle.package->path.c_str());
+		return;
+	}
+	vector<char> contents((char *) data, (char *) data + length);
+	free(data);
+
+	lock_guard<mutex> lock(poolMutex);
+	keptFiles[key] = move(contents);
+}
+
+int OpkPool::readFile(string const& path, string const& name,
+		void **data, size_t *length)
+{
+	shared_ptr<Package> package;
+	{
+		lock_guard<mutex> lock(poolMutex);
+
+		auto kept = keptFiles.find(path + '#' + name);
+		if (kept != keptFiles.end()) {
+			vector<char> const& contents = kept->second;
+			*data = malloc(max<size_t>(contents.size(), 1));
+			if (!*data) return -1;
+			memcpy(*data, contents.data(), contents.size());
+			*length = contents.size();
+			return 0;
+		}
+
+		for (auto& pooled : pool) {
+			if (pooled->path == path) {
+				package = pooled;
+				break;
+			}
+		}
+	}
+
+	if (!package) {
+		struct OPK *opk = opk_open(path.c_str());
+		if (!opk) {
+			ERROR("Unable to open OPK %s\n", path.c_str());
+			return -1;
+		}
+		package = make_shared<Package>(path, opk);
+	}
+
+	// A package that isn't pooled is closed again with the handle.
+	return Handle(move(package)).extractFile(name.c_str(), data, length);
+}
+#endif
@@ -0,0 +1,89 @@
+#ifndef __OPKPOOL_H__
+#define __OPKPOOL_H__
+#ifdef HAVE_LIBOPK
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct OPK;
+
+/**
+ * Keeps recently used OPK packages open while the packages are scanned, so
+ * that reading the meta-data and the icon of a package doesn't reopen it
+ * every time. When the pool is full, the least recently used package is
+ * closed; release() closes them all once the scan is done, so that no
+ * package keeps the card busy while the menu is idle.
+ */
+class OpkPool {
+public:
+	class Package;
+
+	/**
+	 * Exclusive use of an open package: other threads asking for the same
+	 * package wait until the handle is destroyed. The thread holding a
+	 * handle may open the same package again.
+	 */
+	class Handle {
+	public:
+		Handle() {}
+
+		explicit operator bool() const { return !!package; }
+		struct OPK *get() const;
+
+		/**
+		 * Extracts a file from the package into a buffer allocated with
+		 * malloc(). Returns a negative value on error, like libopk.
+		 */
+		int extractFile(const char *name, void **data, size_t *length) const;
+
+	private:
+		friend class OpkPool;
+		explicit Handle(std::shared_ptr<Package> package);
+
+		// Declared in this order so the lock is released first.
+		std::shared_ptr<Package> package;
+		std::unique_lock<std::recursive_mutex> lock;
+	};
+
+	/**
+	 * Returns a handle to the package at the given path, opening it if it
+	 * isn't in the pool yet; the handle is empty if that fails.
+	 * If 'fresh' is true, the package is always reopened: libopk reads the
+	 * meta-data files of a package only once per opened handle.
+	 */
+	static Handle open(std::string const& path, bool fresh = false);
+
+	/**
+	 * Closes all pooled packages whose path starts with the given path.
+	 * Packages that are in use are closed when their last handle goes.
+	 */
+	static void close(std::string const& path);
+
+	/**
+	 * Closes all pooled packages; those in use are closed when their last
+	 * handle goes. Files kept with keepFile() stay available.
+	 */
+	static void release();
+
+	/**
+	 * Extracts a file from an open package and keeps it in memory until the
+	 * package is closed with close(), so that readFile() doesn't have to
+	 * open the package again. Meant for icons, which are only decoded when
+	 * they are first drawn, long after the package was scanned.
+	 */
+	static void keepFile(Handle const& handle, std::string const& name);
+
+	/**
+	 * Reads a file from the package at the given path into a buffer
+	 * allocated with malloc(). Kept files are copied from memory; otherwise
+	 * the package is opened just for this read, unless it is pooled.
+	 * Returns a negative value on error, like libopk.
+	 */
+	static int readFile(std::string const& path, std::string const& name,
+			void **data, size_t *length);
+};
+
+#endif // HAVE_LIBOPK
+#endif // __OPKPOOL_H__
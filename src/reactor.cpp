@@ -0,0 +1,216 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "reactor.h"
+
+#include "debug.h"
+#include "utilities.h"
+
+#include <SDL.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+/** How often SDL is polled when there are no input devices to wait on. */
+#define POLL_INTERVAL_MS 10
+/** How long SDL is pumped for input that arrived on a device. */
+#define SETTLE_TIME_MS 20
+/** How often SDL is pumped meanwhile. */
+#define SETTLE_INTERVAL_MS 2
+
+Reactor &Reactor::instance()
+{
+	static Reactor *reactor = new Reactor;
+	return *reactor;
+}
+
+Reactor::Reactor()
+	: settling(false)
+	, settleDeadline(0)
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd < 0) {
+		ERROR("Unable to create epoll instance: %s\n", strerror(errno));
+	}
+
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeFd < 0) {
+		ERROR("Unable to create eventfd: %s\n", strerror(errno));
+	} else {
+		addFd(wakeFd, [this] {
+			uint64_t count;
+			while (read(wakeFd, &count, sizeof(count)) < 0 && errno == EINTR);
+		});
+	}
+
+	openInputDevices();
+}
+
+void Reactor::openInputDevices()
+{
+	// Opened next to SDL's own handles, which still get every event.
+	for (int fd : ::openInputDevices()) {
+		bool added = addFd(fd, [this, fd] {
+			char buf[1024];
+			ssize_t len;
+			while ((len = read(fd, buf, sizeof(buf))) > 0
+					|| (len < 0 && errno == EINTR));
+			if (len == 0 || errno != EAGAIN) {
+				// Unplugged: stop waiting on it.
+				removeFd(fd);
+				close(fd);
+				inputDevices.erase(fd);
+				return;
+			}
+			settling = true;
+			settleDeadline = SDL_GetTicks() + SETTLE_TIME_MS;
+		});
+		if (added) {
+			inputDevices.insert(fd);
+		} else {
+			close(fd);
+		}
+	}
+	DEBUG("Waiting for input on %zu devices\n", inputDevices.size());
+}
+
+bool Reactor::addFd(int fd, Handler handler)
+{
+	if (epollFd < 0) {
+		return false;
+	}
+
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		ERROR("Unable to watch file descriptor %d: %s\n", fd, strerror(errno));
+		return false;
+	}
+	handlers[fd] = handler;
+	return true;
+}
+
+void Reactor::removeFd(int fd)
+{
+	if (handlers.erase(fd)) {
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+}
+
+void Reactor::wakeup()
+{
+	const uint64_t one = 1;
+	// Only fails if the counter is full, which wakes us up just as well.
+	while (write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+void Reactor::waitForEvent(int timeout)
+{
+	const Uint32 deadline = SDL_GetTicks() + timeout;
+	for (;;) {
+		SDL_PumpEvents();
+		SDL_Event event;
+		if (SDL_PeepEvents(&event, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0) {
+			settling = false;
+			return;
+		}
+
+		const Uint32 now = SDL_GetTicks();
+		int wait = timeout;
+		if (timeout >= 0) {
+			wait = (int32_t) (deadline - now);
+			if (wait <= 0) {
+				return;
+			}
+		}
+		if (settling && (int32_t) (settleDeadline - now) <= 0) {
+			settling = false;
+		}
+		const int interval = settling ? SETTLE_INTERVAL_MS
+				: inputDevices.empty() ? POLL_INTERVAL_MS : -1;
+		if (interval >= 0 && (wait < 0 || wait > interval)) {
+			wait = interval;
+		}
+
+		if (epollFd < 0) {
+			SDL_Delay(wait);
+			continue;
+		}
+
+		struct epoll_event events[8];
+		int n = epoll_wait(epollFd, events, 8, wait);
+		if (n < 0 && errno != EINTR) {
+			ERROR("Waiting for events failed: %s\n", strerror(errno));
+			SDL_Delay(POLL_INTERVAL_MS);
+		}
+		for (int i = 0; i < n; i++) {
+			// Earlier handlers may have removed it.
+			auto it = handlers.find(events[i].data.fd);
+			if (it != handlers.end()) {
+				Handler handler = it->second;
+				handler();
+			}
+		}
+	}
+}
+
+Reactor::Timer::Timer(Handler handler)
+	: handler(handler)
+{
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		ERROR("Unable to create timer: %s\n", strerror(errno));
+		return;
+	}
+
+	Reactor::instance().addFd(fd, [this] {
+		uint64_t expirations;
+		if (read(fd, &expirations, sizeof(expirations)) > 0) {
+			// A copy, in case the handler restarts or replaces the timer.
+			Handler handler = this->handler;
+			handler();
+		}
+	});
+}
+
+Reactor::Timer::~Timer()
+{
+	if (fd >= 0) {
+		Reactor::instance().removeFd(fd);
+		close(fd);
+	}
+}
+
+static struct timespec toTimespec(unsigned int ms)
+{
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	return ts;
+}
+
+void Reactor::Timer::start(unsigned int ms, unsigned int interval)
+{
+	// A zero expiration would disarm the timer instead.
+	struct itimerspec spec;
+	spec.it_value = toTimespec(ms ? ms : 1);
+	spec.it_interval = toTimespec(interval);
+	if (fd >= 0 && timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+		ERROR("Unable to start timer: %s\n", strerror(errno));
+	}
+}
+
+void Reactor::Timer::stop()
+{
+	struct itimerspec spec = {};
+	if (fd >= 0) {
+		timerfd_settime(fd, 0, &spec, nullptr);
+	}
+}
@@ -0,0 +1,84 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __REACTOR_H__
+#define __REACTOR_H__
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * The one place where the main thread sleeps. It waits with epoll for
+ * input, for timers and for wake-ups from other threads, runs the handlers
+ * of what is ready, and returns once SDL has an event queued.
+ * Handlers run on the main thread, in the middle of whatever loop is waiting
+ * for input, so they should only queue SDL events, e.g. request_repaint().
+ */
+class Reactor {
+public:
+	typedef std::function<void(void)> Handler;
+
+	/** A timer on the monotonic clock whose handler runs on the main thread. */
+	class Timer {
+	public:
+		Timer(Handler handler);
+		~Timer();
+		Timer(Timer const&) = delete;
+		Timer& operator=(Timer const&) = delete;
+
+		/**
+		 * Fires in 'ms' milliseconds, and then every 'interval' milliseconds
+		 * if it isn't 0. Restarts the timer if it was running.
+		 */
+		void start(unsigned int ms, unsigned int interval = 0);
+		void stop();
+
+	private:
+		int fd;
+		Handler handler;
+	};
+
+	static Reactor &instance();
+
+	/**
+	 * Calls 'handler' whenever 'fd' is readable; the handler has to read
+	 * what is pending, or it is called again right away.
+	 */
+	bool addFd(int fd, Handler handler);
+	void removeFd(int fd);
+
+	/**
+	 * Makes waitForEvent() look at the SDL queue again. Can be called from
+	 * any thread, after pushing an SDL event.
+	 */
+	void wakeup();
+
+	/**
+	 * Waits until SDL has an event queued, or at most 'timeout' milliseconds
+	 * if it isn't negative.
+	 */
+	void waitForEvent(int timeout = -1);
+
+private:
+	Reactor();
+	void openInputDevices();
+
+	int epollFd, wakeFd;
+	std::unordered_map<int, Handler> handlers;
+	/**
+	 * The input devices SDL reads from. SDL gives no file descriptor to
+	 * wait on, so these tell when to pump it; without them, SDL is polled.
+	 */
+	std::unordered_set<int> inputDevices;
+	/**
+	 * SDL may see device input a bit later, e.g. a key through the tty,
+	 * so it is pumped often until this time (SDL ticks) or until it has
+	 * an event.
+	 */
+	bool settling;
+	uint32_t settleDeadline;
+};
+
+#endif // __REACTOR_H__
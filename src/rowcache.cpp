@@ -0,0 +1,141 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "rowcache.h"
+
+#include "font_stack.h"
+#include "surface.h"
+
+#include <cstring>
+
+using namespace std;
+
+RowCache::RowCache(FontStack const& font, int width, int rowHeight,
+		unsigned int numRows)
+	: font(font)
+	, layer(OffscreenSurface::emptySurface(width, rowHeight * numRows, true))
+	, rowHeight(rowHeight)
+	, numRows(numRows)
+	, valid(false)
+	, firstRow(0)
+	, count(0)
+{
+	if (layer) layer->setUse(SurfaceUse::DIALOG);
+}
+
+RowCache::~RowCache()
+{
+}
+
+void RowCache::invalidate()
+{
+	valid = false;
+}
+
+void RowCache::clearSlots(unsigned int first, unsigned int last)
+{
+	SDL_Surface *raw = layer->getSurface();
+	SDL_SetClipRect(raw, nullptr);
+	SDL_Rect rect = {
+		0, static_cast<Sint16>(first * rowHeight),
+		static_cast<Uint16>(raw->w),
+		static_cast<Uint16>((last - first) * rowHeight),
+	};
+	SDL_FillRect(raw, &rect, 0);
+}
+
+void RowCache::update(unsigned int firstRow, unsigned int count,
+		function<void(unsigned int row)> const& drawRow)
+{
+	if (!layer) {
+		return;
+	}
+
+	// Rows [from, to) of the viewport have to be drawn.
+	unsigned int from = 0, to = numRows;
+	if (valid && count == this->count && firstRow != this->firstRow) {
+		SDL_Surface *raw = layer->getSurface();
+		char *pixels = static_cast<char *>(raw->pixels);
+		const size_t size = raw->pitch * raw->h;
+
+		if (firstRow > this->firstRow && firstRow - this->firstRow < numRows) {
+			const unsigned int delta = firstRow - this->firstRow;
+			const size_t offset = raw->pitch * rowHeight * delta;
+			memmove(pixels, pixels + offset, size - offset);
+			from = numRows - delta;
+		} else if (firstRow < this->firstRow
+				&& this->firstRow - firstRow < numRows) {
+			const unsigned int delta = this->firstRow - firstRow;
+			const size_t offset = raw->pitch * rowHeight * delta;
+			memmove(pixels + offset, pixels, size - offset);
+			to = delta;
+		}
+	} else if (valid && count == this->count) {
+		return;
+	}
+
+	this->firstRow = firstRow;
+	this->count = count;
+	valid = true;
+
+	clearSlots(from, to);
+	for (unsigned int slot = from; slot < to && firstRow + slot < count; slot++) {
+		drawRow(firstRow + slot);
+	}
+	SDL_SetClipRect(layer->getSurface(), nullptr);
+}
+
+SDL_Rect RowCache::clipToRow(unsigned int row)
+{
+	SDL_Surface *raw = layer->getSurface();
+	SDL_Rect rect = {
+		0, static_cast<Sint16>((row - firstRow) * rowHeight),
+		static_cast<Uint16>(raw->w), static_cast<Uint16>(rowHeight),
+	};
+	SDL_SetClipRect(raw, &rect);
+	return rect;
+}
+
+void RowCache::write(unsigned int row, compat::string_view text, int x,
+		Font::VAlign valign)
+{
+	auto rendered = font.render(text);
+	if (!rendered) {
+		return;
+	}
+
+	// The rendered text has a one pixel outline around it.
+	SDL_Rect rect = clipToRow(row);
+	int y = rect.y - 1;
+	switch (valign) {
+	case Font::VAlignTop:
+		break;
+	case Font::VAlignMiddle:
+		y += rowHeight / 2 - font.getLineSpacing() / 2;
+		break;
+	case Font::VAlignBottom:
+		y += rowHeight - font.getLineSpacing();
+		break;
+	}
+
+	// Copy the pixels, alpha included: blending them on a transparent
+	// layer would leave the text transparent as well.
+	SDL_Surface *src = rendered->getSurface();
+	SDL_SetAlpha(src, 0, 0);
+	SDL_Rect dest = { static_cast<Sint16>(x - 1), static_cast<Sint16>(y), 0, 0 };
+	SDL_BlitSurface(src, nullptr, layer->getSurface(), &dest);
+}
+
+void RowCache::fill(unsigned int row, SDL_Rect rect, RGBAColor c)
+{
+	SDL_Surface *raw = layer->getSurface();
+	rect.y += clipToRow(row).y;
+	SDL_FillRect(raw, &rect, c.pixelValue(raw->format));
+}
+
+void RowCache::paint(Surface& s, int x, int y) const
+{
+	if (layer) {
+		layer->blit(s, x, y);
+	}
+}
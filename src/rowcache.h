@@ -0,0 +1,67 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __ROWCACHE_H__
+#define __ROWCACHE_H__
+
+#include <functional>
+#include <memory>
+
+#include <SDL.h>
+
+#include "compat-string_view.h"
+#include "font.h"
+
+class FontStack;
+class OffscreenSurface;
+class Surface;
+struct RGBAColor;
+
+/**
+ * Keeps the rendered rows of the visible part of a list.
+ * When the list scrolls, the rows that stay visible are moved with a single
+ * copy and only the rows that come into view are drawn, so holding a
+ * direction key renders one row of text per step.
+ * The rows are kept on a transparent layer, which is blitted over the
+ * background and selection of the list.
+ */
+class RowCache {
+public:
+	RowCache(FontStack const& font, int width, int rowHeight,
+			unsigned int numRows);
+	~RowCache();
+
+	/** Forgets all rows; needed when the contents of the list changed. */
+	void invalidate();
+
+	/**
+	 * Makes the layer show the rows from 'firstRow' on, out of the 'count'
+	 * rows of the list. 'drawRow' is called for each row that isn't drawn
+	 * yet, and draws it with write() and fill().
+	 */
+	void update(unsigned int firstRow, unsigned int count,
+			std::function<void(unsigned int row)> const& drawRow);
+
+	/** Writes text on a row, at 'x' from the left edge of the layer. */
+	void write(unsigned int row, compat::string_view text, int x,
+			Font::VAlign valign = Font::VAlignTop);
+	/** Fills a rectangle, relative to a row, with a color; no blending. */
+	void fill(unsigned int row, SDL_Rect rect, RGBAColor c);
+
+	void paint(Surface& s, int x, int y) const;
+
+private:
+	/** Sets the clip rectangle of the layer to the given row. */
+	SDL_Rect clipToRow(unsigned int row);
+	void clearSlots(unsigned int first, unsigned int last);
+
+	FontStack const& font;
+	std::unique_ptr<OffscreenSurface> layer;
+	int rowHeight;
+	unsigned int numRows;
+
+	bool valid;
+	unsigned int firstRow, count;
+};
+
+#endif // __ROWCACHE_H__
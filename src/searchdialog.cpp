@@ -0,0 +1,153 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "searchdialog.h"
+
+#include "font_stack.h"
+#include "gmenu2x.h"
+#include "inputdialog.h"
+#include "latency.h"
+#include "surface.h"
+#include "utilities.h"
+
+using namespace std;
+
+/** Upper bound on the number of results listed. */
+static const size_t MAX_RESULTS = 200;
+
+SearchDialog::SearchDialog(GMenu2X& gmenu2x, SearchIndex& index)
+	: Dialog(gmenu2x)
+	, index(index)
+	, selected(0)
+{
+}
+
+bool SearchDialog::askQuery() {
+	InputDialog id(gmenu2x, gmenu2x.input, gmenu2x.tr["Search"], text,
+			"", "skin:icons/explorer.png");
+	if (!id.exec()) {
+		return false;
+	}
+
+	text = id.getInput();
+	results = index.query(text, MAX_RESULTS);
+	selected = 0;
+	return true;
+}
+
+bool SearchDialog::exec() {
+	InputLatency::Context latency("search dialog");
+	if (!askQuery()) {
+		return false;
+	}
+
+	unsigned int top, height;
+	tie(top, height) = gmenu2x.getContentArea();
+
+	const int lineHeight = gmenu2x.font->getLineSpacing();
+	const unsigned int nb_elements = max(height / lineHeight, 1u);
+
+	unsigned int firstElement = 0;
+	bool close = false, result = false;
+	while (!close) {
+		OutputSurface& s = *gmenu2x.s;
+
+		// The subtitle shows the query, so the chrome changes with it.
+		getChrome("search\n" + text + '\n' + (results.empty() ? '-' : 'r'),
+				[&](Surface& bg) {
+			drawTitleIcon(bg, "icons/explorer.png", true);
+			writeTitle(bg, gmenu2x.tr["Search"]);
+			writeSubTitle(bg, "\"" + text + "\"");
+
+			int x = 5;
+			if (!results.empty()) {
+				x = gmenu2x.drawButton(bg, "accept", gmenu2x.tr["Launch"], x);
+			}
+			x = gmenu2x.drawButton(bg, "select", gmenu2x.tr["New search"], x);
+			x = gmenu2x.drawButton(bg, "cancel", gmenu2x.tr["Exit"], x);
+			(void)x;
+		}).blit(s, 0, 0);
+
+		if (results.empty()) {
+			gmenu2x.font->write(s, "(" + gmenu2x.tr["no items"] + ")",
+					4, top + lineHeight / 2,
+					Font::HAlignLeft, Font::VAlignMiddle);
+		} else {
+			if (selected >= firstElement + nb_elements)
+				firstElement = selected - nb_elements + 1;
+			if (selected < firstElement)
+				firstElement = selected;
+
+			int iY = top + (selected - firstElement) * lineHeight;
+			s.box(1, iY, gmenu2x.width() - 11, lineHeight,
+					gmenu2x.skinConfColors[COLOR_SELECTION_BG]);
+
+			s.setClipRect(0, top, gmenu2x.width() - 9, height);
+			for (unsigned int i = firstElement;
+					i < results.size() && i < firstElement + nb_elements; i++) {
+				auto& entry = results[i];
+				iY = top + (i - firstElement) * lineHeight;
+				const bool isFile = !entry.dir.empty();
+				gmenu2x.font->write(s,
+						isFile && gmenu2x.confInt["trimExt"]
+							? trimExtension(entry.name) : entry.name,
+						4, iY + lineHeight / 2,
+						Font::HAlignLeft, Font::VAlignMiddle);
+			}
+			s.clearClipRect();
+		}
+
+		gmenu2x.drawScrollBar(nb_elements, results.size(), firstElement);
+		s.flip();
+
+		switch (gmenu2x.input.waitForPressedButton()) {
+			case InputManager::CANCEL:
+			case InputManager::SETTINGS:
+				close = true;
+				break;
+
+			case InputManager::MENU:
+				if (askQuery()) {
+					firstElement = 0;
+				}
+				break;
+
+			case InputManager::UP:
+				if (results.empty()) break;
+				if (selected == 0) selected = results.size() - 1;
+				else selected -= 1;
+				break;
+
+			case InputManager::DOWN:
+				if (results.empty()) break;
+				if (selected + 1 >= results.size()) selected = 0;
+				else selected += 1;
+				break;
+
+			case InputManager::ALTLEFT:
+				if (selected < nb_elements - 1) selected = 0;
+				else selected -= nb_elements - 1;
+				break;
+
+			case InputManager::ALTRIGHT:
+				if (results.empty()) break;
+				if (selected + nb_elements - 1 >= results.size())
+					selected = results.size() - 1;
+				else
+					selected += nb_elements - 1;
+				break;
+
+			case InputManager::ACCEPT:
+				if (!results.empty()) {
+					close = true;
+					result = true;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return result;
+}
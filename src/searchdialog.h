@@ -0,0 +1,38 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __SEARCHDIALOG_H__
+#define __SEARCHDIALOG_H__
+
+#include "dialog.h"
+#include "searchindex.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Asks for a search query and lists the matching entries of the search
+ * index, so the user can pick one to launch.
+ */
+class SearchDialog : protected Dialog {
+public:
+	SearchDialog(GMenu2X& gmenu2x, SearchIndex& index);
+
+	/**
+	 * Runs the dialog.
+	 * @return True iff a result was selected; see getResult().
+	 */
+	bool exec();
+
+	const SearchIndex::Result &getResult() { return results[selected]; }
+
+private:
+	bool askQuery();
+
+	SearchIndex& index;
+	std::string text;
+	std::vector<SearchIndex::Result> results;
+	unsigned int selected;
+};
+
+#endif // __SEARCHDIALOG_H__
@@ -0,0 +1,807 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#include "searchindex.h"
+
+#include "debug.h"
+#include "filelister.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+#ifdef ENABLE_INOTIFY
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+
+static const uint32_t NO_DIR = UINT32_MAX;
+
+/** Deepest subdirectory level that is scanned below a selector dir. */
+static const unsigned int MAX_DEPTH = 8;
+
+/** Quiet time after the last change before the index is written out. */
+static const int SAVE_DELAY_MS = 5000;
+
+static const char CACHE_MAGIC[4] = { 'G', '2', 'X', 'S' };
+static const uint32_t CACHE_VERSION = 1;
+
+static inline bool isWordChar(char c) {
+	// Bytes of multi-byte UTF-8 sequences are treated as letters.
+	return isalnum((unsigned char)c) || (unsigned char)c >= 0x80;
+}
+
+static string fold(string const& str) {
+	string folded(str);
+	for (char& c : folded) {
+		if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+	}
+	return folded;
+}
+
+static bool hasWordStartingWith(string const& folded, string const& word) {
+	for (size_t pos = folded.find(word); pos != string::npos;
+			pos = folded.find(word, pos + 1)) {
+		if (pos == 0 || !isWordChar(folded[pos - 1])) return true;
+	}
+	return false;
+}
+
+/**
+ * Returns the length of the shortest prefix of 'folded' that contains the
+ * letters of 'needle' in order, or 0 if there is none.
+ */
+static size_t fuzzySpan(string const& folded, string const& needle) {
+	size_t i = 0;
+	for (size_t pos = 0; pos < folded.size(); pos++) {
+		if (folded[pos] == needle[i] && ++i == needle.size()) {
+			return pos + 1;
+		}
+	}
+	return 0;
+}
+
+struct SearchIndex::Snapshot {
+	/** A word start: entries[entry].folded from 'offset' onwards. */
+	struct Token {
+		uint32_t entry, offset;
+	};
+
+	vector<string> keys;
+	vector<string> dirs;
+	vector<Entry> entries;
+	/** Word starts of all entries, in byte order of their text. */
+	vector<Token> tokens;
+
+	const char *tokenText(Token token) const {
+		return entries[token.entry].folded.c_str() + token.offset;
+	}
+
+	void buildTokens();
+	pair<vector<Token>::const_iterator, vector<Token>::const_iterator>
+			tokensWithPrefix(string const& prefix) const;
+
+	bool save(string const& path) const;
+	static shared_ptr<Snapshot> load(string const& path);
+};
+
+void SearchIndex::Snapshot::buildTokens() {
+	tokens.clear();
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		const string& folded = entries[i].folded;
+		for (uint32_t pos = 0; pos < folded.size(); pos++) {
+			if (isWordChar(folded[pos])
+					&& (pos == 0 || !isWordChar(folded[pos - 1]))) {
+				tokens.push_back({ i, pos });
+			}
+		}
+	}
+	sort(tokens.begin(), tokens.end(), [this](Token a, Token b) {
+		return strcmp(tokenText(a), tokenText(b)) < 0;
+	});
+}
+
+pair<vector<SearchIndex::Snapshot::Token>::const_iterator,
+	 vector<SearchIndex::Snapshot::Token>::const_iterator>
+SearchIndex::Snapshot::tokensWithPrefix(string const& prefix) const {
+	const char *p = prefix.c_str();
+	const size_t len = prefix.size();
+	auto first = lower_bound(tokens.begin(), tokens.end(), p,
+			[this, len](Token token, const char *text) {
+				return strncmp(tokenText(token), text, len) < 0;
+			});
+	auto last = upper_bound(first, tokens.end(), p,
+			[this, len](const char *text, Token token) {
+				return strncmp(tokenText(token), text, len) > 0;
+			});
+	return make_pair(first, last);
+}
+
+static void writeU32(ofstream& out, uint32_t value) {
+	out.write((const char *)&value, sizeof(value));
+}
+
+static void writeString(ofstream& out, string const& str) {
+	writeU32(out, str.size());
+	out.write(str.data(), str.size());
+}
+
+static bool readU32(ifstream& in, uint32_t& value) {
+	return !!in.read((char *)&value, sizeof(value));
+}
+
+static bool readString(ifstream& in, string& str) {
+	uint32_t len;
+	if (!readU32(in, len) || len > PATH_MAX) return false;
+	str.resize(len);
+	return !!in.read(&str[0], len);
+}
+
+bool SearchIndex::Snapshot::save(string const& path) const {
+	const string tmpPath = path + ".tmp";
+	ofstream out(tmpPath, ios_base::out | ios_base::binary | ios_base::trunc);
+	if (!out.is_open()) {
+		ERROR("Unable to open '%s' for writing\n", tmpPath.c_str());
+		return false;
+	}
+
+	out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	writeU32(out, CACHE_VERSION);
+	writeU32(out, keys.size());
+	for (auto& key : keys) writeString(out, key);
+	writeU32(out, dirs.size());
+	for (auto& dir : dirs) writeString(out, dir);
+	writeU32(out, entries.size());
+	for (auto& entry : entries) {
+		writeU32(out, entry.source);
+		writeU32(out, entry.dir);
+		writeString(out, entry.name);
+	}
+	writeU32(out, tokens.size());
+	out.write((const char *)tokens.data(), tokens.size() * sizeof(Token));
+	out.close();
+
+	if (out.fail() || rename(tmpPath.c_str(), path.c_str())) {
+		ERROR("Unable to write search index to '%s'\n", path.c_str());
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+shared_ptr<SearchIndex::Snapshot> SearchIndex::Snapshot::load(
+		string const& path) {
+	ifstream in(path, ios_base::in | ios_base::binary);
+	if (!in.is_open()) {
+		return nullptr;
+	}
+
+	auto snapshot = make_shared<Snapshot>();
+	char magic[sizeof(CACHE_MAGIC)];
+	uint32_t version, count;
+	if (!in.read(magic, sizeof(magic))
+			|| memcmp(magic, CACHE_MAGIC, sizeof(magic))
+			|| !readU32(in, version) || version != CACHE_VERSION) {
+		goto invalid;
+	}
+
+	if (!readU32(in, count)) goto invalid;
+	snapshot->keys.resize(count);
+	for (auto& key : snapshot->keys) {
+		if (!readString(in, key)) goto invalid;
+	}
+
+	if (!readU32(in, count)) goto invalid;
+	snapshot->dirs.resize(count);
+	for (auto& dir : snapshot->dirs) {
+		if (!readString(in, dir)) goto invalid;
+	}
+
+	if (!readU32(in, count)) goto invalid;
+	snapshot->entries.resize(count);
+	for (auto& entry : snapshot->entries) {
+		if (!readU32(in, entry.source) || !readU32(in, entry.dir)
+				|| !readString(in, entry.name)
+				|| entry.source >= snapshot->keys.size()
+				|| (entry.dir != NO_DIR && entry.dir >= snapshot->dirs.size())) {
+			goto invalid;
+		}
+		entry.folded = fold(entry.name);
+	}
+
+	if (!readU32(in, count)) goto invalid;
+	snapshot->tokens.resize(count);
+	if (!in.read((char *)snapshot->tokens.data(), count * sizeof(Token))) {
+		goto invalid;
+	}
+	for (auto token : snapshot->tokens) {
+		if (token.entry >= snapshot->entries.size() || token.offset
+				>= snapshot->entries[token.entry].folded.size()) {
+			goto invalid;
+		}
+	}
+
+	return snapshot;
+
+invalid:
+	WARNING("Ignoring invalid search index '%s'\n", path.c_str());
+	return nullptr;
+}
+
+SearchIndex::SearchIndex(string const& cacheFile)
+	: cacheFile(cacheFile)
+	, snapshot(make_shared<Snapshot>())
+	, hasPending(false)
+	, quit(false)
+{
+#ifdef ENABLE_INOTIFY
+	inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (inotifyFd < 0) {
+		WARNING("Unable to start inotify; the search index will not follow"
+				" file changes\n");
+	}
+#endif
+
+	if (pipe2(wakeupFds, O_CLOEXEC | O_NONBLOCK) < 0) {
+		ERROR("Unable to create search index pipe: %s\n", strerror(errno));
+		wakeupFds[0] = wakeupFds[1] = -1;
+		return;
+	}
+
+	thread = std::thread(&SearchIndex::run, this);
+}
+
+SearchIndex::~SearchIndex()
+{
+	if (thread.joinable()) {
+		quit = true;
+		write(wakeupFds[1], "", 1);
+		thread.join();
+	}
+
+	if (wakeupFds[0] >= 0) {
+		close(wakeupFds[0]);
+		close(wakeupFds[1]);
+	}
+#ifdef ENABLE_INOTIFY
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#endif
+}
+
+void SearchIndex::setSources(vector<Source> sources)
+{
+	{
+		lock_guard<std::mutex> lock(mutex);
+		pending = move(sources);
+		hasPending = true;
+	}
+	if (wakeupFds[1] >= 0) {
+		write(wakeupFds[1], "", 1);
+	}
+}
+
+size_t SearchIndex::size() const
+{
+	lock_guard<std::mutex> lock(mutex);
+	return snapshot->entries.size();
+}
+
+vector<SearchIndex::Result> SearchIndex::query(
+		string const& text, size_t maxResults) const
+{
+	shared_ptr<const Snapshot> snap;
+	{
+		lock_guard<std::mutex> lock(mutex);
+		snap = snapshot;
+	}
+
+	vector<string> words;
+	const string folded = fold(text);
+	for (size_t pos = 0; pos < folded.size(); ) {
+		if (!isWordChar(folded[pos])) {
+			pos++;
+			continue;
+		}
+		size_t end = pos;
+		while (end < folded.size() && isWordChar(folded[end])) end++;
+		words.push_back(folded.substr(pos, end - pos));
+		pos = end;
+	}
+
+	vector<Result> results;
+	if (words.empty() || maxResults == 0) {
+		return results;
+	}
+
+	struct Match {
+		uint32_t entry;
+		size_t score;
+	};
+	vector<Match> matches;
+	vector<bool> matched(snap->entries.size());
+
+	// Word prefix matches: look up the first word in the token table, then
+	// check the remaining words against the candidates.
+	auto range = snap->tokensWithPrefix(words[0]);
+	for (auto it = range.first; it != range.second; ++it) {
+		const Entry& entry = snap->entries[it->entry];
+		if (matched[it->entry]) continue;
+
+		bool ok = true;
+		for (size_t i = 1; ok && i < words.size(); i++) {
+			ok = hasWordStartingWith(entry.folded, words[i]);
+		}
+		if (ok) {
+			matched[it->entry] = true;
+			// Matches at the start of the name go first, then shorter names.
+			size_t score = (it->offset == 0 ? 0 : 1024) + entry.name.size();
+			matches.push_back({ it->entry, score });
+		}
+	}
+
+	// Fuzzy matches: the query letters appear in order.
+	string needle;
+	for (auto& word : words) needle += word;
+	if (matches.size() < maxResults && needle.size() > 1) {
+		for (uint32_t i = 0; i < snap->entries.size(); i++) {
+			if (matched[i]) continue;
+			size_t span = fuzzySpan(snap->entries[i].folded, needle);
+			if (span) {
+				matches.push_back({ i, (size_t)1 << 20 | span << 10
+						| min(snap->entries[i].name.size(), (size_t)1023) });
+			}
+		}
+	}
+
+	auto last = matches.size() > maxResults
+			? matches.begin() + maxResults : matches.end();
+	partial_sort(matches.begin(), last, matches.end(),
+			[&snap](Match const& a, Match const& b) {
+				if (a.score != b.score) return a.score < b.score;
+				return snap->entries[a.entry].folded
+						< snap->entries[b.entry].folded;
+			});
+
+	results.reserve(last - matches.begin());
+	for (auto it = matches.begin(); it != last; ++it) {
+		const Entry& entry = snap->entries[it->entry];
+		results.push_back({
+			snap->keys[entry.source],
+			entry.name,
+			entry.dir == NO_DIR ? string() : snap->dirs[entry.dir],
+		});
+	}
+	return results;
+}
+
+void SearchIndex::run()
+{
+	if (auto cached = Snapshot::load(cacheFile)) {
+		DEBUG("Loaded %zu search index entries from '%s'\n",
+				cached->entries.size(), cacheFile.c_str());
+		lock_guard<std::mutex> lock(mutex);
+		snapshot = move(cached);
+	}
+
+	bool dirty = false;
+	while (!quit) {
+		struct pollfd fds[2] = {
+			{ wakeupFds[0], POLLIN, 0 },
+#ifdef ENABLE_INOTIFY
+			{ inotifyFd, POLLIN, 0 },
+#else
+			{ -1, 0, 0 },
+#endif
+		};
+		int ret = poll(fds, 2, dirty ? SAVE_DELAY_MS : -1);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			ERROR("Search index poll failed: %s\n", strerror(errno));
+			break;
+		}
+
+		if (ret == 0) {
+			save();
+			dirty = false;
+			continue;
+		}
+
+		bool changed = false;
+		if (fds[0].revents & POLLIN) {
+			char buf[64];
+			while (read(wakeupFds[0], buf, sizeof(buf)) > 0);
+
+			vector<Source> newSources;
+			bool update;
+			{
+				lock_guard<std::mutex> lock(mutex);
+				update = hasPending;
+				newSources = move(pending);
+				hasPending = false;
+			}
+			if (update) {
+				changed = applySources(newSources);
+			}
+		}
+#ifdef ENABLE_INOTIFY
+		if (fds[1].revents & POLLIN) {
+			changed |= readEvents();
+		}
+#endif
+
+		if (changed && !quit) {
+			publish();
+			dirty = true;
+		}
+	}
+
+	if (dirty) {
+		save();
+	}
+}
+
+bool SearchIndex::applySources(vector<Source>& newSources)
+{
+	vector<bool> keep(sources.size());
+	bool changed = false;
+
+	for (auto& source : newSources) {
+		if (!source.dir.empty() && source.dir.back() != '/') {
+			source.dir += '/';
+		}
+
+		uint32_t i;
+		for (i = 0; i < sources.size(); i++) {
+			auto& old = sources[i];
+			if (old.alive && !keep[i] && old.source.key == source.key
+					&& old.source.dir == source.dir
+					&& old.source.filter == source.filter
+					&& old.source.browse == source.browse) {
+				break;
+			}
+		}
+
+		if (i == sources.size()) {
+			addSource(source);
+			keep.push_back(true);
+			changed = true;
+		} else {
+			keep[i] = true;
+			if (sources[i].source.title != source.title) {
+				sources[i].source.title = source.title;
+				for (auto& entry : entries) {
+					if (entry.source == i && entry.dir == NO_DIR) {
+						entry.name = source.title;
+						entry.folded = fold(source.title);
+					}
+				}
+				changed = true;
+			}
+		}
+		if (quit) return false;
+	}
+
+	for (uint32_t i = 0; i < keep.size(); i++) {
+		if (!keep[i] && sources[i].alive) {
+			dropSource(i);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void SearchIndex::addSource(Source& source)
+{
+	const uint32_t index = sources.size();
+	sources.push_back({ source, true });
+	entries.push_back({ source.title, fold(source.title), index, NO_DIR });
+
+	if (!source.dir.empty()) {
+		scanDir(source.dir, index, 0);
+	}
+}
+
+void SearchIndex::dropSource(uint32_t source)
+{
+	sources[source].alive = false;
+
+	vector<bool> doomed(dirs.size());
+	for (uint32_t i = 0; i < dirs.size(); i++) {
+		doomed[i] = dirs[i].source == source && !dirs[i].path.empty();
+	}
+	dropDirs(doomed);
+
+	entries.erase(remove_if(entries.begin(), entries.end(),
+			[source](Entry const& entry) { return entry.source == source; }),
+			entries.end());
+}
+
+void SearchIndex::scanDir(
+		string const& path, uint32_t source, unsigned int depth)
+{
+	if (quit) return;
+
+	const uint32_t dir = dirs.size();
+	dirs.push_back({ path, source, depth, -1 });
+#ifdef ENABLE_INOTIFY
+	// Watch before listing, so no file created in between goes unnoticed.
+	watch(dir);
+#endif
+
+	auto const& src = sources[source].source;
+	FileLister fl;
+	fl.setShowUpdir(false);
+	fl.setShowDirectories(src.browse && depth < MAX_DEPTH);
+	fl.setFilter(src.filter);
+	if (!fl.browse(path)) {
+		return;
+	}
+
+	for (auto& file : fl.getFiles()) {
+		entries.push_back({ file, fold(file), source, dir });
+	}
+	for (auto& subdir : fl.getDirectories()) {
+		scanDir(path + subdir + "/", source, depth + 1);
+	}
+}
+
+void SearchIndex::rescanDir(uint32_t dir)
+{
+	entries.erase(remove_if(entries.begin(), entries.end(),
+			[dir](Entry const& entry) { return entry.dir == dir; }),
+			entries.end());
+
+	FileLister fl;
+	fl.setShowDirectories(false);
+	fl.setFilter(sources[dirs[dir].source].source.filter);
+	if (fl.browse(dirs[dir].path)) {
+		for (auto& file : fl.getFiles()) {
+			entries.push_back({ file, fold(file), dirs[dir].source, dir });
+		}
+	}
+}
+
+void SearchIndex::dropDirs(vector<bool> const& doomed)
+{
+	bool any = false;
+	for (uint32_t i = 0; i < doomed.size(); i++) {
+		if (!doomed[i]) continue;
+#ifdef ENABLE_INOTIFY
+		unwatch(i);
+#endif
+		// The slot stays until compact(), so that the indices of other
+		// dirs don't change while events are being handled.
+		dirs[i].path.clear();
+		any = true;
+	}
+
+	if (any) {
+		entries.erase(remove_if(entries.begin(), entries.end(),
+				[&doomed](Entry const& entry) {
+					return entry.dir != NO_DIR && entry.dir < doomed.size()
+							&& doomed[entry.dir];
+				}), entries.end());
+	}
+}
+
+#ifdef ENABLE_INOTIFY
+void SearchIndex::watch(uint32_t dir)
+{
+	if (inotifyFd < 0) return;
+
+	int wd = inotify_add_watch(inotifyFd, dirs[dir].path.c_str(),
+			IN_CREATE | IN_DELETE | IN_MOVE | IN_CLOSE_WRITE
+			| IN_DELETE_SELF | IN_ONLYDIR);
+	if (wd < 0) {
+		if (errno != ENOENT) {
+			WARNING("Unable to watch '%s': %s\n",
+					dirs[dir].path.c_str(), strerror(errno));
+		}
+		return;
+	}
+
+	dirs[dir].wd = wd;
+	watches[wd].push_back(dir);
+}
+
+void SearchIndex::unwatch(uint32_t dir)
+{
+	const int wd = dirs[dir].wd;
+	if (wd < 0) return;
+	dirs[dir].wd = -1;
+
+	auto it = watches.find(wd);
+	if (it == watches.end()) return;
+
+	auto& list = it->second;
+	list.erase(remove(list.begin(), list.end(), dir), list.end());
+	if (list.empty()) {
+		inotify_rm_watch(inotifyFd, wd);
+		watches.erase(it);
+	}
+}
+
+bool SearchIndex::readEvents()
+{
+	vector<bool> rescan(dirs.size()), doomed(dirs.size());
+	vector<pair<string, uint32_t>> created;
+	bool overflow = false;
+
+	alignas(struct inotify_event) char buf[4096];
+	for (;;) {
+		ssize_t len = read(inotifyFd, buf, sizeof(buf));
+		if (len <= 0) break;
+
+		for (char *ptr = buf; ptr < buf + len; ) {
+			auto event = reinterpret_cast<struct inotify_event *>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				overflow = true;
+				continue;
+			}
+
+			auto it = watches.find(event->wd);
+			if (it == watches.end()) continue;
+
+			if (event->mask & IN_IGNORED) {
+				// The kernel dropped the watch.
+				for (uint32_t dir : it->second) dirs[dir].wd = -1;
+				watches.erase(it);
+				continue;
+			}
+
+			for (uint32_t dir : it->second) {
+				if (event->mask & IN_DELETE_SELF) {
+					doomed[dir] = true;
+				} else if (!(event->mask & IN_ISDIR)) {
+					rescan[dir] = true;
+				} else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					created.emplace_back(
+							dirs[dir].path + event->name + "/", dir);
+				} else {
+					// Deleted or moved away: drop that whole tree.
+					const string prefix = dirs[dir].path + event->name + "/";
+					for (uint32_t i = 0; i < dirs.size(); i++) {
+						if (dirs[i].source == dirs[dir].source
+								&& dirs[i].path.compare(
+									0, prefix.size(), prefix) == 0) {
+							doomed[i] = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (overflow) {
+		// Events were lost; start over.
+		WARNING("Search index missed file changes; rescanning\n");
+		vector<Source> current;
+		for (auto& source : sources) {
+			if (source.alive) current.push_back(source.source);
+		}
+		for (uint32_t i = 0; i < sources.size(); i++) {
+			if (sources[i].alive) dropSource(i);
+		}
+		for (auto& source : current) {
+			addSource(source);
+		}
+		return true;
+	}
+
+	bool changed = false;
+	if (find(doomed.begin(), doomed.end(), true) != doomed.end()) {
+		dropDirs(doomed);
+		changed = true;
+	}
+
+	for (uint32_t i = 0; i < rescan.size(); i++) {
+		if (rescan[i] && !doomed[i] && !dirs[i].path.empty()) {
+			rescanDir(i);
+			changed = true;
+		}
+	}
+
+	for (auto& subdir : created) {
+		const DirState parent = dirs[subdir.second];
+		if (parent.path.empty() || parent.depth >= MAX_DEPTH
+				|| !sources[parent.source].source.browse) {
+			continue;
+		}
+		bool known = false;
+		for (auto& dir : dirs) {
+			if (dir.source == parent.source && dir.path == subdir.first) {
+				known = true;
+				break;
+			}
+		}
+		if (!known) {
+			scanDir(subdir.first, parent.source, parent.depth + 1);
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+#endif
+
+void SearchIndex::compact()
+{
+	vector<uint32_t> sourceMap(sources.size(), NO_DIR);
+	uint32_t numSources = 0;
+	for (uint32_t i = 0; i < sources.size(); i++) {
+		if (!sources[i].alive) continue;
+		sourceMap[i] = numSources;
+		if (numSources != i) sources[numSources] = move(sources[i]);
+		numSources++;
+	}
+
+	vector<uint32_t> dirMap(dirs.size(), NO_DIR);
+	uint32_t numDirs = 0;
+	for (uint32_t i = 0; i < dirs.size(); i++) {
+		if (dirs[i].path.empty()) continue;
+		dirMap[i] = numDirs;
+		if (numDirs != i) dirs[numDirs] = move(dirs[i]);
+		dirs[numDirs].source = sourceMap[dirs[numDirs].source];
+		numDirs++;
+	}
+
+	if (numSources == sources.size() && numDirs == dirs.size()) {
+		return;
+	}
+	sources.resize(numSources);
+	dirs.resize(numDirs);
+
+	// Entries and watches of dropped sources and dirs are already gone.
+	for (auto& entry : entries) {
+		entry.source = sourceMap[entry.source];
+		if (entry.dir != NO_DIR) entry.dir = dirMap[entry.dir];
+	}
+#ifdef ENABLE_INOTIFY
+	for (auto& watch : watches) {
+		for (uint32_t& dir : watch.second) dir = dirMap[dir];
+	}
+#endif
+}
+
+void SearchIndex::publish()
+{
+	compact();
+
+	auto snap = make_shared<Snapshot>();
+	snap->keys.reserve(sources.size());
+	for (auto& source : sources) {
+		snap->keys.push_back(source.alive ? source.source.key : string());
+	}
+	snap->dirs.reserve(dirs.size());
+	for (auto& dir : dirs) {
+		snap->dirs.push_back(dir.path);
+	}
+	snap->entries = entries;
+	snap->buildTokens();
+
+	DEBUG("Search index updated: %zu entries, %zu words\n",
+			snap->entries.size(), snap->tokens.size());
+
+	lock_guard<std::mutex> lock(mutex);
+	snapshot = move(snap);
+}
+
+void SearchIndex::save()
+{
+	shared_ptr<const Snapshot> snap;
+	{
+		lock_guard<std::mutex> lock(mutex);
+		snap = snapshot;
+	}
+	snap->save(cacheFile);
+}
@@ -0,0 +1,127 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+#ifndef __SEARCHINDEX_H__
+#define __SEARCHINDEX_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * Index of everything that can be launched: the links themselves and the
+ * files in the selector directory of each link.
+ * Scanning is done by a background thread, which also follows changes to
+ * the scanned directories with inotify; queries run on the calling thread
+ * against the last complete snapshot and never wait for the scanner.
+ * The snapshot is written to disk, so that results are available right
+ * after startup while the scanner catches up.
+ */
+class SearchIndex {
+public:
+	/**
+	 * A link to index. If 'dir' is not empty, the files in it that pass
+	 * 'filter' are indexed as well, recursing into subdirectories when
+	 * 'browse' is set, just like the selector would show them.
+	 */
+	struct Source {
+		/** Identifies the link; opaque to the index. */
+		std::string key;
+		std::string title;
+		std::string dir, filter;
+		bool browse;
+	};
+
+	struct Result {
+		std::string key;
+		std::string name;
+		/** Directory of the matched file, or empty if the link itself
+		 *  matched. Ends with a slash. */
+		std::string dir;
+	};
+
+	SearchIndex(std::string const& cacheFile);
+	~SearchIndex();
+
+	/**
+	 * Replaces the set of indexed links. Links that did not change keep
+	 * their entries; new or changed ones are scanned in the background.
+	 */
+	void setSources(std::vector<Source> sources);
+
+	/**
+	 * Returns up to 'maxResults' matches for 'text', best first.
+	 * Entries having a word that starts with each of the query words
+	 * rank before entries that merely contain the query letters in order.
+	 */
+	std::vector<Result> query(std::string const& text, size_t maxResults) const;
+
+	/** Returns the number of entries in the current snapshot. */
+	size_t size() const;
+
+private:
+	struct Snapshot;
+
+	struct SourceState {
+		Source source;
+		bool alive;
+	};
+
+	struct DirState {
+		std::string path;
+		uint32_t source;
+		unsigned int depth;
+		int wd;
+	};
+
+	struct Entry {
+		std::string name, folded;
+		uint32_t source, dir;
+	};
+
+	void run();
+
+	bool applySources(std::vector<Source>& newSources);
+	void addSource(Source& source);
+	void dropSource(uint32_t source);
+	void scanDir(std::string const& path, uint32_t source, unsigned int depth);
+	void rescanDir(uint32_t dir);
+	void dropDirs(std::vector<bool> const& doomed);
+	/** Reclaims the slots of dropped sources and dirs. */
+	void compact();
+#ifdef ENABLE_INOTIFY
+	bool readEvents();
+	void watch(uint32_t dir);
+	void unwatch(uint32_t dir);
+#endif
+	void publish();
+	void save();
+
+	const std::string cacheFile;
+
+	mutable std::mutex mutex;
+	std::shared_ptr<const Snapshot> snapshot;
+	std::vector<Source> pending;
+	bool hasPending;
+
+	std::atomic<bool> quit;
+	int wakeupFds[2];
+	std::thread thread;
+
+	// Only used by the scanner thread:
+	std::vector<SourceState> sources;
+	std::vector<DirState> dirs;
+	std::vector<Entry> entries;
+#ifdef ENABLE_INOTIFY
+	int inotifyFd;
+	std::unordered_map<int, std::vector<uint32_t>> watches;
+#endif
+};
+
+#endif // __SEARCHINDEX_H__
@@ -24,8 +24,10 @@
 #include "debug.h"
 #include "filelister.h"
 #include "gmenu2x.h"
+#include "latency.h"
 #include "linkapp.h"
 #include "menu.h"
+#include "rowcache.h"
 #include "surface.h"
 #include "utilities.h"
 
@@ -64,6 +66,7 @@ int Selector::searchFile(const std::string &file, FileLister &fl) {
 }
 
 int Selector::exec(int startSelection) {
+	InputLatency::Context latency("selector");
 	const bool showDirectories = link.getSelectorBrowser();
 
 	FileLister fl;
@@ -77,23 +80,28 @@ int Selector::exec(int startSelection) {
 	if(link.getSelectorFile().size()>0)
 		startSelection=searchFile(link.getSelectorFile(),fl);
 
-	OffscreenSurface bg(*gmenu2x.bg);
-	drawTitleIcon(bg, link.getIconPath(), true);
-	writeTitle(bg, link.getTitle());
-	writeSubTitle(bg, link.getDescription());
-
-	int x = 5;
-	if (fl.size() != 0) {
-		x = gmenu2x.drawButton(bg, "accept", gmenu2x.tr["Select"], x);
-	}
-	if (showDirectories) {
-		x = gmenu2x.drawButton(bg, "left", "", x);
-		x = gmenu2x.drawButton(bg, "cancel", gmenu2x.tr["Up one folder"], x);
-	} else {
-		x = gmenu2x.drawButton(bg, "cancel", "", x);
-	}
-	x = gmenu2x.drawButton(bg, "start", gmenu2x.tr["Exit"], x);
-	(void)x;
+	const string chromeKey = "selector\n" + link.getIconPath()
+			+ '\n' + link.getTitle() + '\n' + link.getDescription()
+			+ '\n' + (fl.size() != 0 ? 'f' : '-')
+			+ (showDirectories ? 'd' : '-');
+	auto drawChrome = [&](Surface& bg) {
+		drawTitleIcon(bg, link.getIconPath(), true);
+		writeTitle(bg, link.getTitle());
+		writeSubTitle(bg, link.getDescription());
+
+		int x = 5;
+		if (fl.size() != 0) {
+			x = gmenu2x.drawButton(bg, "accept", gmenu2x.tr["Select"], x);
+		}
+		if (showDirectories) {
+			x = gmenu2x.drawButton(bg, "left", "", x);
+			x = gmenu2x.drawButton(bg, "cancel", gmenu2x.tr["Up one folder"], x);
+		} else {
+			x = gmenu2x.drawButton(bg, "cancel", "", x);
+		}
+		x = gmenu2x.drawButton(bg, "start", gmenu2x.tr["Exit"], x);
+		(void)x;
+	};
 
 	unsigned int top, height;
 	tie(top, height) = gmenu2x.getContentArea();
@@ -110,7 +118,8 @@ int Selector::exec(int startSelection) {
 	lineHeight = height / nb_elements;
 	top += (height - lineHeight * nb_elements) / 2;
 
-	bg.convertToDisplayFormat();
+	RowCache rows(*gmenu2x.font, gmenu2x.width() - 9, lineHeight, nb_elements);
+	const int folderTextX = folderIcon ? 4 + folderIcon->width() + 2 : 4;
 
 	unsigned int firstElement = 0;
 	unsigned int selected = compat::clamp(startSelection, 0, (int)fl.size() - 1);
@@ -119,7 +128,7 @@ int Selector::exec(int startSelection) {
 	while (!close) {
 		OutputSurface& s = *gmenu2x.s;
 
-		bg.blit(s, 0, 0);
+		getChrome(chromeKey, drawChrome).blit(s, 0, 0);
 
 		if (fl.size() == 0) {
 			gmenu2x.font->write(s, "(" + gmenu2x.tr["no items"] + ")",
@@ -134,8 +143,10 @@ int Selector::exec(int startSelection) {
 			//Screenshot
 			if (fl.isFile(selected)) {
 				string path = screendir + trimExtension(fl[selected]) + ".png";
-				auto screenshot = OffscreenSurface::loadImage(path, false);
+				auto screenshot = OffscreenSurface::loadImage(path, false,
+						gmenu2x.width(), gmenu2x.height());
 				if (screenshot) {
+					screenshot->setUse(SurfaceUse::DIALOG);
 					screenshot->blitRight(s, gmenu2x.width(), 0, gmenu2x.width(), gmenu2x.height(), 128u);
 				}
 			}
@@ -145,61 +156,66 @@ int Selector::exec(int startSelection) {
 			if (selected<fl.size())
 				s.box(1, iY, gmenu2x.width()-11, lineHeight, gmenu2x.skinConfColors[COLOR_SELECTION_BG]);
 
+			rows.update(firstElement, fl.size(), [&](unsigned int i) {
+				if (fl.isDirectory(i)) {
+					rows.write(i, fl[i], folderTextX, Font::VAlignMiddle);
+				} else {
+					rows.write(i, (gmenu2x.confInt["trimExt"] ? trimExtension(fl[i]) : fl[i]),
+							4, Font::VAlignMiddle);
+				}
+			});
+
 			//Files & Dirs
 			s.setClipRect(0, top, gmenu2x.width()-9, height);
 			for (unsigned int i = firstElement;
 					i < fl.size() && i < firstElement + nb_elements; i++) {
-				iY = top + (i - firstElement) * lineHeight;
-				x = 4;
-				if (fl.isDirectory(i)) {
-					if (folderIcon) {
-						folderIcon->blit(s,
-								x, iY + (lineHeight - folderIcon->height()) / 2);
-						x += folderIcon->width() + 2;
-					}
-					gmenu2x.font->write(s, fl[i],
-							x, iY + lineHeight / 2,
-							Font::HAlignLeft, Font::VAlignMiddle);
-				} else {
-					gmenu2x.font->write(s, (gmenu2x.confInt["trimExt"] ? trimExtension(fl[i]) : fl[i]),
-							x, iY + lineHeight / 2,
-							Font::HAlignLeft, Font::VAlignMiddle);
+				if (fl.isDirectory(i) && folderIcon) {
+					iY = top + (i - firstElement) * lineHeight;
+					folderIcon->blit(s,
+							4, iY + (lineHeight - folderIcon->height()) / 2);
 				}
 			}
+			rows.paint(s, 0, top);
 			s.clearClipRect();
 		}
 
 		gmenu2x.drawScrollBar(nb_elements, fl.size(), firstElement);
 		s.flip();
 
-		switch (gmenu2x.input.waitForPressedButton()) {
+		// Screenshots make frames slow, so repeats are taken together.
+		unsigned int steps;
+		switch (gmenu2x.input.waitForPressedButton(&steps)) {
 			case InputManager::SETTINGS:
 				close = true;
 				result = false;
 				break;
 
 			case InputManager::UP:
-				if (selected == 0) selected = fl.size() -1;
-				else selected -= 1;
+				for (unsigned int i = 0; i < steps; i++) {
+					if (selected == 0) selected = fl.size() -1;
+					else selected -= 1;
+				}
 				break;
 
 			case InputManager::ALTLEFT:
-				if ((int)(selected - nb_elements + 1) < 0)
+				if (selected < steps * (nb_elements - 1))
 					selected = 0;
 				else
-					selected -= nb_elements - 1;
+					selected -= steps * (nb_elements - 1);
 				break;
 
 			case InputManager::DOWN:
-				if (selected+1>=fl.size()) selected = 0;
-				else selected += 1;
+				for (unsigned int i = 0; i < steps; i++) {
+					if (selected+1>=fl.size()) selected = 0;
+					else selected += 1;
+				}
 				break;
 
 			case InputManager::ALTRIGHT:
-				if (selected + nb_elements - 1 >= fl.size())
+				if (selected + steps * (nb_elements - 1) >= fl.size())
 					selected = fl.size() - 1;
 				else
-					selected += nb_elements - 1;
+					selected += steps * (nb_elements - 1);
 				break;
 
 			case InputManager::CANCEL:
@@ -213,6 +229,7 @@ int Selector::exec(int startSelection) {
 				if (showDirectories) {
 					selected = goToParentDir(fl);
 					firstElement = 0;
+					rows.invalidate();
 				}
 				break;
 
@@ -231,6 +248,7 @@ int Selector::exec(int startSelection) {
 							selected = 0;
 						}
 						firstElement = 0;
+						rows.invalidate();
 					}
 				}
 				break;
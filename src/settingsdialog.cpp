@@ -21,9 +21,11 @@
 #include "settingsdialog.h"
 
 #include "gmenu2x.h"
+#include "latency.h"
 #include "menusetting.h"
 
 #include <SDL.h>
+#include <sstream>
 
 using namespace std;
 
@@ -42,8 +44,15 @@ SettingsDialog::SettingsDialog(
 }
 
 bool SettingsDialog::exec() {
-	OffscreenSurface bg(*gmenu2x.bg);
-	bg.convertToDisplayFormat();
+	InputLatency::Context latency("settings");
+	auto drawChrome = [&](Surface& bg) {
+		gmenu2x.drawTopBar(bg);
+		//link icon
+		drawTitleIcon(bg, icon);
+		writeTitle(bg, text);
+
+		gmenu2x.drawBottomBar(bg);
+	};
 
 	bool close = false;
 	uint32_t i, sel = 0, firstElement = 0;
@@ -60,14 +69,12 @@ bool SettingsDialog::exec() {
 	while (!close) {
 		OutputSurface& s = *gmenu2x.s;
 
-		bg.blit(s, 0, 0);
-
-		gmenu2x.drawTopBar(s);
-		//link icon
-		drawTitleIcon(s, icon);
-		writeTitle(s, text);
-
-		gmenu2x.drawBottomBar(s);
+		// The skin menu edits the bar colors while it is shown.
+		stringstream chromeKey;
+		chromeKey << "settings\n" << icon << '\n' << text << '\n'
+				<< gmenu2x.skinConfColors[COLOR_TOP_BAR_BG] << '\n'
+				<< gmenu2x.skinConfColors[COLOR_BOTTOM_BAR_BG];
+		getChrome(chromeKey.str(), drawChrome).blit(s, 0, 0);
 
 		if (sel>firstElement+numRows-1) firstElement=sel-numRows+1;
 		if (sel<firstElement) firstElement=sel;
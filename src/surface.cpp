@@ -23,11 +23,18 @@
 #include "compat-algorithm.h"
 #include "debug.h"
 #include "imageio.h"
+#include "latency.h"
 #include "utilities.h"
 #include "buildopts.h"
 
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
+#include <unistd.h>
 #include <utility>
 
 using namespace std;
@@ -62,6 +69,109 @@ ostream& operator<<(ostream& os, RGBAColor const& color) {
 }
 
 
+// SurfaceMemory:
+
+static const char *const surfaceUseNames[] = {
+	"other", "collection", "link text", "section labels",
+	"background", "menu pages", "FunKey menu", "dialogs",
+};
+static const size_t SURFACE_USES =
+		sizeof(surfaceUseNames) / sizeof(surfaceUseNames[0]);
+
+// Atomic, since surfaces are also made and freed by other threads.
+// The last entries are the totals of all uses.
+static atomic<size_t> liveBytes[SURFACE_USES + 1], peakBytes[SURFACE_USES + 1];
+
+static size_t surfaceBytes(SDL_Surface const *surface)
+{
+	return surface ? (size_t) surface->pitch * surface->h : 0;
+}
+
+static void addBytes(size_t i, size_t bytes)
+{
+	const size_t live = liveBytes[i].fetch_add(bytes, memory_order_relaxed)
+			+ bytes;
+	size_t peak = peakBytes[i].load(memory_order_relaxed);
+	while (live > peak && !peakBytes[i].compare_exchange_weak(
+			peak, live, memory_order_relaxed)) {
+	}
+}
+
+void SurfaceMemory::add(SurfaceUse use, SDL_Surface const *surface)
+{
+	const size_t bytes = surfaceBytes(surface);
+	if (bytes) {
+		addBytes(static_cast<size_t>(use), bytes);
+		addBytes(SURFACE_USES, bytes);
+	}
+}
+
+void SurfaceMemory::remove(SurfaceUse use, SDL_Surface const *surface)
+{
+	const size_t bytes = surfaceBytes(surface);
+	liveBytes[static_cast<size_t>(use)].fetch_sub(bytes, memory_order_relaxed);
+	liveBytes[SURFACE_USES].fetch_sub(bytes, memory_order_relaxed);
+}
+
+/** Appends a right-aligned number of KiB to 'out'; no stdio involved. */
+static char *appendKiB(char *out, size_t bytes, int width)
+{
+	char digits[24];
+	int n = 0;
+	size_t kib = (bytes + 1023) / 1024;
+	do {
+		digits[n++] = '0' + kib % 10;
+		kib /= 10;
+	} while (kib);
+	for (int i = n; i < width; i++) {
+		*out++ = ' ';
+	}
+	while (n) {
+		*out++ = digits[--n];
+	}
+	return out;
+}
+
+static char *appendLine(char *out, const char *name, size_t live, size_t peak)
+{
+	const size_t len = strlen(name);
+	memcpy(out, name, len);
+	out += len;
+	for (size_t i = len; i < 16; i++) {
+		*out++ = ' ';
+	}
+	out = appendKiB(out, live, 8);
+	out = appendKiB(out, peak, 8);
+	*out++ = '\n';
+	return out;
+}
+
+void SurfaceMemory::writeReport(int fd)
+{
+	char buf[(SURFACE_USES + 3) * 64];
+	char *out = buf;
+	static const char header[] = "Surface memory  live KiB peak KiB\n";
+	memcpy(out, header, sizeof(header) - 1);
+	out += sizeof(header) - 1;
+
+	for (size_t i = 0; i <= SURFACE_USES; i++) {
+		out = appendLine(out, i < SURFACE_USES ? surfaceUseNames[i] : "total",
+				liveBytes[i].load(memory_order_relaxed),
+				peakBytes[i].load(memory_order_relaxed));
+	}
+
+	const char *p = buf;
+	while (p < out) {
+		ssize_t n = write(fd, p, out - p);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR) continue;
+			break;
+		}
+		p += n;
+	}
+}
+
+
 // Surface:
 
 Surface::Surface(Surface const& other)
@@ -89,6 +199,13 @@ void Surface::blit(Surface& destination, int x, int y, int w, int h, int a) cons
 	blit(destination.raw, x, y, w, h, a);
 }
 
+void Surface::blitRegion(Surface& destination, SDL_Rect src, int x, int y) const {
+	SDL_Rect dest;
+	dest.x = x;
+	dest.y = y;
+	SDL_BlitSurface(raw, &src, destination.raw, &dest);
+}
+
 void Surface::blitCenter(SDL_Surface *destination, int x, int y, int w, int h, int a) const {
 	int ow = raw->w / 2; if (w != 0) ow = min(ow, w / 2);
 	int oh = raw->h / 2; if (h != 0) oh = min(oh, h / 2);
@@ -209,6 +326,72 @@ static inline uint32_t mult8x4(uint32_t c, uint8_t a) {
 	     | ((((c & 0x00FF00FF) * a) & 0xFF00FF00) >> 8);
 }
 
+// RGB565 pixels are blended with 5-bit alpha on all three components at
+// once, after spreading them apart as 00000GGGGGG00000RRRRR000000BBBBB so
+// that each one has room for the product.
+static const uint32_t SPREAD_565_MASK = 0x07E0F81F;
+
+static inline uint32_t spread565(uint16_t pixel) {
+	return (pixel | (uint32_t(pixel) << 16)) & SPREAD_565_MASK;
+}
+
+static inline uint16_t pack565(uint32_t c) {
+	c &= SPREAD_565_MASK;
+	return uint16_t(c | (c >> 16));
+}
+
+bool Surface::isRGB565() const {
+	const SDL_PixelFormat *format = raw->format;
+	return format->BytesPerPixel == 2 && format->Rmask == 0xF800
+		&& format->Gmask == 0x07E0 && format->Bmask == 0x001F;
+}
+
+void Surface::blendMask(SDL_Surface *mask, int x, int y, RGBAColor c) {
+	SDL_Rect rect = {
+		static_cast<Sint16>(x), static_cast<Sint16>(y),
+		static_cast<Uint16>(mask->w), static_cast<Uint16>(mask->h)
+	};
+	applyClipRect(rect);
+	if (rect.w == 0 || rect.h == 0) {
+		return;
+	}
+
+	if (SDL_MUSTLOCK(raw)) {
+		if (SDL_LockSurface(raw) < 0) {
+			return;
+		}
+	}
+
+	const uint32_t color = spread565(uint16_t(c.pixelValue(raw->format)));
+	const uint8_t *src = static_cast<uint8_t*>(mask->pixels)
+	                   + (rect.y - y) * mask->pitch + (rect.x - x);
+	uint8_t *edge = static_cast<uint8_t*>(raw->pixels)
+	              + rect.y * raw->pitch + rect.x * 2;
+
+	for (auto row = 0; row < rect.h; row++) {
+		uint16_t *pixels = reinterpret_cast<uint16_t*>(edge);
+		for (auto col = 0; col < rect.w; col++) {
+			const uint32_t alpha = (src[col] + 4) >> 3;
+			if (alpha == 0) {
+				continue;
+			}
+			if (alpha >= 32) {
+				pixels[col] = pack565(color);
+				continue;
+			}
+			const uint32_t pixel = spread565(pixels[col]);
+			pixels[col] = pack565(
+					(color * alpha + pixel * (32 - alpha)) >> 5);
+		}
+		src += mask->pitch;
+		edge += raw->pitch;
+	}
+
+	if (SDL_MUSTLOCK(raw)) {
+		SDL_UnlockSurface(raw);
+	}
+}
+
 void Surface::fillRectAlpha(SDL_Rect rect, RGBAColor c) {
 	applyClipRect(rect);
 	if (rect.w == 0 || rect.h == 0) {
@@ -232,7 +415,19 @@ void Surface::fillRectAlpha(SDL_Rect rect, RGBAColor c) {
 
 	// Blending: surf' = surf * (1 - alpha) + fill * alpha
 
-	if (format->BytesPerPixel == 2) {
+	if (isRGB565()) {
+		// Pre-multiply the fill color.
+		const uint32_t f = spread565(uint16_t(color)) * ((alpha + 4) >> 3);
+		const uint32_t inverse = 32 - ((alpha + 4) >> 3);
+
+		for (auto y = 0; y < rect.h; y++) {
+			uint16_t *pixels = reinterpret_cast<uint16_t*>(edge);
+			for (auto x = 0; x < rect.w; x++) {
+				pixels[x] = pack565((spread565(pixels[x]) * inverse + f) >> 5);
+			}
+			edge += raw->pitch;
+		}
+	} else if (format->BytesPerPixel == 2) {
 		uint32_t Rmask = format->Rmask;
 		uint32_t Gmask = format->Gmask;
 		uint32_t Bmask = format->Bmask;
@@ -281,20 +476,60 @@ void Surface::fillRectAlpha(SDL_Rect rect, RGBAColor c) {
 
 // OffscreenSurface:
 
+/**
+ * Returns true iff surfaces of the given format can be blitted to the
+ * screen without conversion, and SDL_DisplayFormat() would not change them.
+ */
+static bool isDisplayFormat(
+		const SDL_PixelFormat *format, const SDL_PixelFormat *display) {
+	return format->BitsPerPixel == display->BitsPerPixel
+		&& !format->palette && !format->Amask
+		&& format->Rmask == display->Rmask
+		&& format->Gmask == display->Gmask
+		&& format->Bmask == display->Bmask;
+}
+
 unique_ptr<OffscreenSurface> OffscreenSurface::emptySurface(
-		int width, int height)
+		int width, int height, bool alpha)
 {
-	SDL_Surface *raw = SDL_CreateRGBSurface(
-			SDL_SWSURFACE, width, height, 32, 0, 0, 0, 0);
+	SDL_Surface *raw;
+	SDL_Surface *screen = SDL_GetVideoSurface();
+	if (alpha) {
+		raw = SDL_CreateRGBSurface(
+				SDL_SWSURFACE | SDL_SRCALPHA, width, height, 32,
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+				0xff << 8, 0xff << 16, 0xff << 24, 0xff
+#else
+				0xff << 16, 0xff << 8, 0xff, 0xffu << 24
+#endif
+				);
+	} else if (screen) {
+		// Created in the display format, so a 16-bit screen gets 16-bit
+		// backgrounds and pages.
+		const SDL_PixelFormat *format = screen->format;
+		raw = SDL_CreateRGBSurface(
+				SDL_SWSURFACE, width, height, format->BitsPerPixel,
+				format->Rmask, format->Gmask, format->Bmask, 0);
+	} else {
+		raw = SDL_CreateRGBSurface(
+				SDL_SWSURFACE, width, height, 32, 0, 0, 0, 0);
+	}
 	if (!raw) return unique_ptr<OffscreenSurface>();
-	SDL_FillRect(raw, nullptr, SDL_MapRGB(raw->format, 0, 0, 0));
+	SDL_FillRect(raw, nullptr, SDL_MapRGBA(raw->format, 0, 0, 0, 0));
 	return unique_ptr<OffscreenSurface>(new OffscreenSurface(raw));
 }
 
 unique_ptr<OffscreenSurface> OffscreenSurface::loadImage(
-		string const& img, bool loadAlpha)
+		string const& img, bool loadAlpha,
+		unsigned int maxWidth, unsigned int maxHeight)
 {
-	SDL_Surface *raw = loadPNG(img, loadAlpha);
+	// Images without alpha are decoded straight into the display format,
+	// so convertToDisplayFormat() has nothing left to do for them.
+	SDL_Surface *screen = SDL_GetVideoSurface();
+	SDL_Surface *raw = !loadAlpha && screen
+			? loadPNG(img, false, screen->format, PNG_DITHER,
+					maxWidth, maxHeight)
+			: loadPNG(img, loadAlpha, nullptr, 0, maxWidth, maxHeight);
 	if (!raw) {
 		DEBUG("Couldn't load surface '%s'\n", img.c_str());
 		return unique_ptr<OffscreenSurface>();
@@ -303,14 +538,32 @@ unique_ptr<OffscreenSurface> OffscreenSurface::loadImage(
 	return unique_ptr<OffscreenSurface>(new OffscreenSurface(raw));
 }
 
+vector<unique_ptr<OffscreenSurface>> OffscreenSurface::loadImageParts(
+		string const& img, vector<PNGRegion> const& regions, bool loadAlpha)
+{
+	vector<unique_ptr<OffscreenSurface>> parts;
+	vector<SDL_Surface *> raws(regions.size());
+	if (!loadPNGRegions(img, loadAlpha,
+			regions.data(), regions.size(), raws.data())) {
+		DEBUG("Couldn't load parts of surface '%s'\n", img.c_str());
+		return parts;
+	}
+	for (SDL_Surface *raw : raws) {
+		parts.emplace_back(new OffscreenSurface(raw));
+	}
+	return parts;
+}
+
 OffscreenSurface::OffscreenSurface(OffscreenSurface&& other)
 	: Surface(other.raw)
+	, use(other.use)
 {
 	other.raw = nullptr;
 }
 
 OffscreenSurface::~OffscreenSurface()
 {
+	SurfaceMemory::remove(use, raw);
 	SDL_FreeSurface(raw);
 }
 
@@ -323,16 +576,62 @@ OffscreenSurface& OffscreenSurface::operator=(OffscreenSurface other)
 void OffscreenSurface::swap(OffscreenSurface& other)
 {
 	std::swap(raw, other.raw);
+	std::swap(use, other.use);
+}
+
+void OffscreenSurface::setUse(SurfaceUse use)
+{
+	SurfaceMemory::remove(this->use, raw);
+	this->use = use;
+	SurfaceMemory::add(use, raw);
 }
 
 void OffscreenSurface::convertToDisplayFormat() {
+	SDL_Surface *screen = SDL_GetVideoSurface();
+	if (screen && isDisplayFormat(raw->format, screen->format)) {
+		return;
+	}
+
 	SDL_Surface *newSurface = SDL_DisplayFormat(raw);
 	if (newSurface) {
+		SurfaceMemory::remove(use, raw);
+		SurfaceMemory::add(use, newSurface);
 		SDL_FreeSurface(raw);
 		raw = newSurface;
 	}
 }
 
+/** Where the headless backend writes frames; empty with a real screen. */
+static string frameDir;
+enum class FrameFormat { PNG, RAW, NONE };
+static FrameFormat frameFormat = FrameFormat::PNG;
+static unsigned int frameNumber = 0;
+
+void OutputSurface::selectBackend()
+{
+	const char *dir = getenv("GMENU2X_HEADLESS");
+	if (!dir || !*dir) {
+		return;
+	}
+
+	frameDir = dir;
+	const char *format = getenv("GMENU2X_FRAME_FORMAT");
+	if (format && !strcmp(format, "raw")) {
+		frameFormat = FrameFormat::RAW;
+	} else if (format && !strcmp(format, "none")) {
+		frameFormat = FrameFormat::NONE;
+	}
+
+	// The dummy driver renders into a plain memory buffer.
+	setenv("SDL_VIDEODRIVER", "dummy", 1);
+	INFO("Headless output, writing frames to %s\n", dir);
+}
+
+string const& OutputSurface::headlessDir()
+{
+	return frameDir;
+}
+
 bool OutputSurface::resolutionSupported(int width, int height)
 {
 	return !!SDL_VideoModeOK(width, height, 32, SDL_ANYFORMAT);
@@ -356,5 +655,51 @@ unique_ptr<OutputSurface> OutputSurface::open(
 }
 
 void OutputSurface::flip() {
+	if (!frameDir.empty() && frameFormat != FrameFormat::NONE) {
+		dumpFrame();
+	}
 	SDL_Flip(raw);
+	InputLatency::frameShown();
+}
+
+void OutputSurface::dumpFrame() {
+	char name[32];
+	const bool rawPixels = frameFormat == FrameFormat::RAW;
+	snprintf(name, sizeof(name), "/frame-%05u.%s",
+			frameNumber, rawPixels ? "raw" : "png");
+	const string path = frameDir + name;
+
+	if (!rawPixels) {
+		savePNG(raw, path);
+		frameNumber++;
+		return;
+	}
+
+	if (frameNumber == 0) {
+		const SDL_PixelFormat *format = raw->format;
+		INFO("Raw frames are %dx%d, %d bpp, masks R %08x G %08x B %08x\n",
+				raw->w, raw->h, format->BitsPerPixel,
+				format->Rmask, format->Gmask, format->Bmask);
+	}
+	frameNumber++;
+
+	FILE *fp = fopen(path.c_str(), "wb");
+	if (!fp) {
+		ERROR("Unable to create '%s'\n", path.c_str());
+		return;
+	}
+	if (SDL_MUSTLOCK(raw) && SDL_LockSurface(raw) < 0) {
+		fclose(fp);
+		return;
+	}
+	// Rows are written without the padding of the pitch.
+	const size_t rowSize = raw->w * raw->format->BytesPerPixel;
+	for (int y = 0; y < raw->h; y++) {
+		fwrite(static_cast<char *>(raw->pixels) + y * raw->pitch,
+				rowSize, 1, fp);
+	}
+	if (SDL_MUSTLOCK(raw)) {
+		SDL_UnlockSurface(raw);
+	}
+	fclose(fp);
 }
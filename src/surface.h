@@ -23,11 +23,13 @@
 #define SURFACE_H
 
 #include "font_stack.h"
+#include "imageio.h"
 
 #include <SDL.h>
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include <ostream>
 #include <string>
 
@@ -43,6 +45,39 @@ struct RGBAColor {
 };
 std::ostream& operator<<(std::ostream& os, RGBAColor const& color);
 
+/** What the pixel memory of a surface is used for. */
+enum class SurfaceUse {
+	OTHER,
+	/** Images held by SurfaceCollection. */
+	COLLECTION,
+	/** Rendered titles and descriptions of links. */
+	LINK_TEXT,
+	SECTION_LABEL,
+	/** The wallpaper with the bars drawn on it. */
+	BACKGROUND,
+	MENU_PAGE,
+	FUNKEY_MENU,
+	/** Anything that lives only as long as a dialog. */
+	DIALOG,
+};
+
+/**
+ * Accounts for the pixel memory held by surfaces, per use, to size caches
+ * and find leaks. OffscreenSurface does this by itself; surfaces that are
+ * managed directly with SDL have to be added and removed explicitly.
+ */
+class SurfaceMemory {
+public:
+	static void add(SurfaceUse use, SDL_Surface const *surface);
+	static void remove(SurfaceUse use, SDL_Surface const *surface);
+
+	/**
+	 * Writes the live and peak bytes of each use to the given file
+	 * descriptor. Only uses write(), so it is safe in a signal handler.
+	 */
+	static void writeReport(int fd);
+};
+
 /**
  * Abstract base class for surfaces; wraps SDL_Surface.
  */
@@ -61,6 +96,8 @@ public:
 	void blit(Surface& destination, SDL_Rect container, Font::HAlign halign = Font::HAlignLeft, Font::VAlign valign = Font::VAlignTop) const;
 	void blitCenter(Surface& destination, int x, int y, int w=0, int h=0, int a=-1) const;
 	void blitRight(Surface& destination, int x, int y, int w=0, int h=0, int a=-1) const;
+	/** Blits the 'src' rectangle of this surface at (x, y) on the destination. */
+	void blitRegion(Surface& destination, SDL_Rect src, int x, int y) const;
 
 	void box(SDL_Rect re, RGBAColor c);
 	void box(Sint16 x, Sint16 y, Uint16 w, Uint16 h, RGBAColor c) {
@@ -99,6 +136,16 @@ private:
 	  */
 	void fillRectAlpha(SDL_Rect rect, RGBAColor c);
 
+	/** Returns true if the pixels are 16-bit RGB565, which has its own
+	  * blending code.
+	  */
+	bool isRGB565() const;
+
+	/** Blends the given color into this RGB565 surface, using the 8-bit
+	  * pixels of 'mask' as coverage, with the top left corner at (x, y).
+	  */
+	void blendMask(SDL_Surface *mask, int x, int y, RGBAColor c);
+
 	/** Clips the given rectangle against this surface's active clipping
 	  * rectangle.
 	  */
@@ -110,13 +157,39 @@ private:
  */
 class OffscreenSurface: public Surface {
 public:
+	/**
+	 * Creates a surface filled with black or, if 'alpha' is set, one with
+	 * an alpha channel that is fully transparent.
+	 */
 	static std::unique_ptr<OffscreenSurface> emptySurface(
-			int width, int height);
+			int width, int height, bool alpha = false);
+	/**
+	 * Loads a PNG image. If a maximum size is given, larger images are
+	 * shrunk while they are decoded so that they fit in it.
+	 */
 	static std::unique_ptr<OffscreenSurface> loadImage(
-			std::string const& img, bool loadAlpha = true);
+			std::string const& img, bool loadAlpha = true,
+			unsigned int maxWidth = 0, unsigned int maxHeight = 0);
+	/**
+	 * Loads the given rectangles of a PNG image, decoding it once; only
+	 * the rows up to the end of the lowest rectangle are decoded. Returns
+	 * an empty vector if any of them could not be loaded.
+	 * Safe to call from any thread.
+	 */
+	static std::vector<std::unique_ptr<OffscreenSurface>> loadImageParts(
+			std::string const& img, std::vector<PNGRegion> const& regions,
+			bool loadAlpha = true);
 
-	OffscreenSurface(Surface const& other) : Surface(other) {}
-	OffscreenSurface(OffscreenSurface const& other) : Surface(other) {}
+	OffscreenSurface(Surface const& other)
+		: Surface(other), use(SurfaceUse::OTHER)
+	{
+		SurfaceMemory::add(use, raw);
+	}
+	OffscreenSurface(OffscreenSurface const& other)
+		: Surface(other), use(SurfaceUse::OTHER)
+	{
+		SurfaceMemory::add(use, raw);
+	}
 	OffscreenSurface(OffscreenSurface&& other);
 	~OffscreenSurface();
 	OffscreenSurface& operator=(OffscreenSurface other);
@@ -129,9 +202,17 @@ public:
 	 */
 	void convertToDisplayFormat();
 
+	/** Accounts for the pixel memory of this surface under the given use. */
+	void setUse(SurfaceUse use);
+
 private:
 	friend class FontStack;
-	OffscreenSurface(SDL_Surface *raw) : Surface(raw) {}
+	OffscreenSurface(SDL_Surface *raw) : Surface(raw), use(SurfaceUse::OTHER)
+	{
+		SurfaceMemory::add(use, raw);
+	}
+
+	SurfaceUse use;
 };
 
 /**
@@ -144,6 +225,23 @@ public:
 
 	static bool resolutionSupported(int width, int height);
 
+	/**
+	 * Selects the headless backend if $GMENU2X_HEADLESS is set: the screen
+	 * is then a framebuffer in memory, from SDL's dummy video driver, and
+	 * every frame is written to the directory named by that variable.
+	 * Frames are PNG files, or the raw pixels in the screen format if
+	 * $GMENU2X_FRAME_FORMAT is "raw". If it is "none", frames are not
+	 * written on flip, e.g. when an input script writes the ones it needs.
+	 * Must be called before the video subsystem is initialized.
+	 */
+	static void selectBackend();
+
+	/**
+	 * Returns the directory of the headless backend, or an empty string
+	 * when a real screen is used.
+	 */
+	static std::string const& headlessDir();
+
 	/**
 	 * Offers the current buffer to the video system to be presented and
 	 * acquires a new buffer to draw into.
@@ -152,6 +250,9 @@ public:
 
 private:
 	OutputSurface(SDL_Surface *raw) : Surface(raw) {}
+
+	/** Writes the current buffer to the frame directory. */
+	void dumpFrame();
 };
 
 #endif
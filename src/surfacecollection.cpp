@@ -110,6 +110,7 @@ OffscreenSurface *SurfaceCollection::add(const string &path) {
 	DEBUG("Adding surface: '%s'\n", path.c_str());
 	auto surface = OffscreenSurface::loadImage(filePath);
 	if (surface == nullptr) return nullptr;
+	surface->setUse(SurfaceUse::COLLECTION);
 	return (surfaces[path] = std::move(surface)).get();
 }
 
@@ -124,6 +125,7 @@ OffscreenSurface *SurfaceCollection::addSkinRes(const string &path, bool useDefa
 	DEBUG("Adding skin surface: '%s'\n", path.c_str());
 	auto surface = OffscreenSurface::loadImage(skinpath);
 	if (surface == nullptr) return nullptr;
+	surface->setUse(SurfaceUse::COLLECTION);
 	return (surfaces[path] = std::move(surface)).get();
 }
 
@@ -21,6 +21,7 @@
 #include "textdialog.h"
 
 #include "gmenu2x.h"
+#include "latency.h"
 #include "utilities.h"
 #include "word_wrap.h"
 
@@ -30,6 +31,7 @@ using namespace std;
 
 TextDialog::TextDialog(GMenu2X& gmenu2x, const string &title, const string &description, const string &icon, const string &text)
 	: Dialog(gmenu2x)
+	, rowsText(nullptr)
 {
 	split(this->text, wordWrap(*gmenu2x.font, text, gmenu2x.width() - 15), "\n");
 	this->title = title;
@@ -43,42 +45,54 @@ void TextDialog::drawText(const vector<string> &text, unsigned int y,
 	Surface& s = *gmenu2x.s;
 	const int fontHeight = gmenu2x.font->getLineSpacing();
 
-	for (unsigned i = firstRow; i < firstRow + rowsPerPage && i < text.size(); i++) {
+	if (!rows) {
+		rows.reset(new RowCache(*gmenu2x.font, gmenu2x.width() - 9,
+				fontHeight, rowsPerPage));
+	}
+	if (&text != rowsText) {
+		rows->invalidate();
+		rowsText = &text;
+	}
+
+	rows->update(firstRow, text.size(), [&](unsigned int i) {
 		const string &line = text.at(i);
-		int rowY = y + (i - firstRow) * fontHeight;
 		if (line == "----") { // horizontal ruler
-			rowY += fontHeight / 2;
-			s.box(5, rowY, gmenu2x.width() - 16, 1, 255, 255, 255, 130);
-			s.box(5, rowY+1, gmenu2x.width() - 16, 1, 0, 0, 0, 130);
+			const Uint16 width = gmenu2x.width() - 16;
+			const Sint16 rowY = fontHeight / 2;
+			rows->fill(i, SDL_Rect{ 5, rowY, width, 1 },
+					RGBAColor(255, 255, 255, 130));
+			rows->fill(i, SDL_Rect{ 5, static_cast<Sint16>(rowY + 1), width, 1 },
+					RGBAColor(0, 0, 0, 130));
 		} else {
-			gmenu2x.font->write(s, line, 5, rowY);
+			rows->write(i, line, 5);
 		}
-	}
+	});
+	rows->paint(s, 0, y);
 
 	gmenu2x.drawScrollBar(rowsPerPage, text.size(), firstRow);
 }
 
 void TextDialog::exec() {
+	InputLatency::Context latency("text dialog");
 	bool close = false;
 
-	OffscreenSurface bg(*gmenu2x.bg);
-
-	//link icon
-	if (!fileExists(icon))
-		drawTitleIcon(bg, "icons/ebook.png", true);
-	else
-		drawTitleIcon(bg, icon, false);
-	writeTitle(bg, title);
-	writeSubTitle(bg, description);
-
-	int x = 5;
-	x = gmenu2x.drawButton(bg, "up", "", x);
-	x = gmenu2x.drawButton(bg, "down", gmenu2x.tr["Scroll"], x);
-	x = gmenu2x.drawButton(bg, "cancel", "", x);
-	x = gmenu2x.drawButton(bg, "start", gmenu2x.tr["Exit"], x);
-	(void)x;
-
-	bg.convertToDisplayFormat();
+	const string chromeKey = "text\n" + icon + '\n' + title + '\n' + description;
+	auto drawChrome = [&](Surface& bg) {
+		//link icon
+		if (!fileExists(icon))
+			drawTitleIcon(bg, "icons/ebook.png", true);
+		else
+			drawTitleIcon(bg, icon, false);
+		writeTitle(bg, title);
+		writeSubTitle(bg, description);
+
+		int x = 5;
+		x = gmenu2x.drawButton(bg, "up", "", x);
+		x = gmenu2x.drawButton(bg, "down", gmenu2x.tr["Scroll"], x);
+		x = gmenu2x.drawButton(bg, "cancel", "", x);
+		x = gmenu2x.drawButton(bg, "start", gmenu2x.tr["Exit"], x);
+		(void)x;
+	};
 
 	const int fontHeight = gmenu2x.font->getLineSpacing();
 	unsigned int contentY, contentHeight;
@@ -92,23 +106,25 @@ void TextDialog::exec() {
 	while (!close) {
 		OutputSurface& s = *gmenu2x.s;
 
-		bg.blit(s, 0, 0);
+		getChrome(chromeKey, drawChrome).blit(s, 0, 0);
 		drawText(text, contentY, firstRow, rowsPerPage);
 		s.flip();
 
-		switch(gmenu2x.input.waitForPressedButton()) {
+		unsigned int steps;
+		switch(gmenu2x.input.waitForPressedButton(&steps)) {
 			case InputManager::UP:
-				if (firstRow > 0) firstRow--;
+				firstRow = firstRow > steps ? firstRow - steps : 0;
 				break;
 			case InputManager::DOWN:
-				if (firstRow < maxFirstRow) firstRow++;
+				firstRow = min(firstRow + steps, maxFirstRow);
 				break;
 			case InputManager::ALTLEFT:
-				if (firstRow >= rowsPerPage - 1) firstRow -= rowsPerPage - 1;
+				if (firstRow >= steps * (rowsPerPage - 1))
+					firstRow -= steps * (rowsPerPage - 1);
 				else firstRow = 0;
 				break;
 			case InputManager::ALTRIGHT:
-				firstRow = min(firstRow + rowsPerPage - 1, maxFirstRow);
+				firstRow = min(firstRow + steps * (rowsPerPage - 1), maxFirstRow);
 				break;
 			case InputManager::SETTINGS:
 			case InputManager::CANCEL:
@@ -22,7 +22,9 @@
 #define TEXTDIALOG_H
 
 #include "dialog.h"
+#include "rowcache.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -34,6 +36,11 @@ protected:
 	void drawText(const std::vector<std::string> &text, unsigned int y,
 			unsigned int firstRow, unsigned int rowsPerPage);
 
+private:
+	std::unique_ptr<RowCache> rows;
+	/** The text that is drawn in 'rows'. */
+	const std::vector<std::string> *rowsText;
+
 public:
 	TextDialog(GMenu2X& gmenu2x, const std::string &title,
 			const std::string &description, const std::string &icon,
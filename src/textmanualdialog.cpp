@@ -21,6 +21,7 @@
 #include "textmanualdialog.h"
 
 #include "gmenu2x.h"
+#include "latency.h"
 #include "surface.h"
 #include "utilities.h"
 
@@ -70,25 +71,25 @@ TextManualDialog::TextManualDialog(GMenu2X& gmenu2x, const string &title, const
 }
 
 void TextManualDialog::exec() {
-	OffscreenSurface bg(*gmenu2x.bg);
-
-	//link icon
-	if (!fileExists(icon))
-		drawTitleIcon(bg, "icons/ebook.png", true);
-	else
-		drawTitleIcon(bg, icon, false);
-	writeTitle(bg, title+(description.empty() ? "" : ": "+description));
-
-	int x = 5;
-	x = gmenu2x.drawButton(bg, "up", "", x);
-	x = gmenu2x.drawButton(bg, "down", gmenu2x.tr["Scroll"], x);
-	x = gmenu2x.drawButton(bg, "left", "", x);
-	x = gmenu2x.drawButton(bg, "right", gmenu2x.tr["Change page"], x);
-	x = gmenu2x.drawButton(bg, "cancel", "", x);
-	x = gmenu2x.drawButton(bg, "start", gmenu2x.tr["Exit"], x);
-	(void)x;
-
-	bg.convertToDisplayFormat();
+	InputLatency::Context latency("manual");
+	const string chromeKey = "manual\n" + icon + '\n' + title + '\n' + description;
+	auto drawChrome = [&](Surface& bg) {
+		//link icon
+		if (!fileExists(icon))
+			drawTitleIcon(bg, "icons/ebook.png", true);
+		else
+			drawTitleIcon(bg, icon, false);
+		writeTitle(bg, title+(description.empty() ? "" : ": "+description));
+
+		int x = 5;
+		x = gmenu2x.drawButton(bg, "up", "", x);
+		x = gmenu2x.drawButton(bg, "down", gmenu2x.tr["Scroll"], x);
+		x = gmenu2x.drawButton(bg, "left", "", x);
+		x = gmenu2x.drawButton(bg, "right", gmenu2x.tr["Change page"], x);
+		x = gmenu2x.drawButton(bg, "cancel", "", x);
+		x = gmenu2x.drawButton(bg, "start", gmenu2x.tr["Exit"], x);
+		(void)x;
+	};
 
 	stringstream ss;
 	ss << pages.size();
@@ -104,18 +105,19 @@ void TextManualDialog::exec() {
 
 	unsigned page = 0, firstRow = 0;
 	bool close = false;
+	const auto pageLabel = gmenu2x.tr.intern("Page");
 
 	while (!close) {
 		OutputSurface& s = *gmenu2x.s;
 
-		bg.blit(s,0,0);
+		getChrome(chromeKey, drawChrome).blit(s, 0, 0);
 		writeSubTitle(s, pages[page].title);
 		drawText(pages[page].text, contentY, firstRow, rowsPerPage);
 
 		ss.clear();
 		ss << page+1;
 		ss >> pageStatus;
-		pageStatus = gmenu2x.tr["Page"]+": "+pageStatus+"/"+spagecount;
+		pageStatus = gmenu2x.tr[pageLabel]+": "+pageStatus+"/"+spagecount;
 		gmenu2x.font->write(s, pageStatus, 310, 230, Font::HAlignRight, Font::VAlignMiddle);
 
 		s.flip();
@@ -123,12 +125,13 @@ void TextManualDialog::exec() {
 		const unsigned maxFirstRow = pages[page].text.size() < rowsPerPage
 				? 0 : pages[page].text.size() - rowsPerPage;
 
-		switch(gmenu2x.input.waitForPressedButton()) {
+		unsigned int steps;
+		switch(gmenu2x.input.waitForPressedButton(&steps)) {
 			case InputManager::UP:
-				if (firstRow > 0) firstRow--;
+				firstRow = firstRow > steps ? firstRow - steps : 0;
 				break;
 			case InputManager::DOWN:
-				if (firstRow < maxFirstRow) firstRow++;
+				firstRow = min(firstRow + steps, maxFirstRow);
 				break;
 			case InputManager::LEFT:
 				if (page > 0) {
@@ -143,11 +146,12 @@ void TextManualDialog::exec() {
 				}
 				break;
 			case InputManager::ALTLEFT:
-				if (firstRow >= rowsPerPage - 1) firstRow -= rowsPerPage - 1;
+				if (firstRow >= steps * (rowsPerPage - 1))
+					firstRow -= steps * (rowsPerPage - 1);
 				else firstRow = 0;
 				break;
 			case InputManager::ALTRIGHT:
-				firstRow = min(firstRow + rowsPerPage - 1, maxFirstRow);
+				firstRow = min(firstRow + steps * (rowsPerPage - 1), maxFirstRow);
 				break;
 			case InputManager::CANCEL:
 			case InputManager::SETTINGS:
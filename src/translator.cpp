@@ -24,9 +24,9 @@
 #include "gmenu2x.h"
 #include "utilities.h"
 
+#include <cctype>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <stdarg.h>
 
 using namespace std;
@@ -45,6 +45,10 @@ bool Translator::exists(const string &term) {
 
 void Translator::setLang(const string &lang) {
 	translations.clear();
+	// Interned terms are resolved again in the new language when used.
+	for (auto& message : messages) {
+		message.resolved = false;
+	}
 
 	string line;
 	ifstream infile ((GMenu2X::getHome() + "/translations/" + lang).c_str(), ios_base::in);
@@ -65,37 +69,98 @@ void Translator::setLang(const string &lang) {
 	}
 }
 
-string Translator::translate(const string &term,const char *replacestr,...) {
-	string result = term;
+Translator::MessageId Translator::intern(const string &term) {
+	auto it = termIds.find(term);
+	if (it != termIds.end()) {
+		return it->second;
+	}
 
+	const MessageId id = static_cast<MessageId>(terms.size());
+	terms.push_back(term);
+	messages.push_back(Message { string(), {}, false });
+	termIds.emplace(term, id);
+	return id;
+}
+
+const Translator::Message &Translator::resolve(MessageId id) {
+	Message &message = messages[static_cast<unsigned int>(id)];
+	if (message.resolved) {
+		return message;
+	}
+
+	const string &term = terms[static_cast<unsigned int>(id)];
+	message.text = term;
 	if (!_lang.empty()) {
-		unordered_map<string, string>::iterator i = translations.find(term);
-		if (i != translations.end()) {
-			result = i->second;
+		auto it = translations.find(term);
+		if (it != translations.end()) {
+			message.text = it->second;
+		} else {
+			// Reported once per term, not every time it is drawn.
+			WARNING("Untranslated string: '%s'\n", term.c_str());
 		}
+	}
 
-		else WARNING("Untranslated string: '%s'\n", term.c_str());
+	// Split the text at its $N placeholders.
+	message.segments.clear();
+	const string &text = message.text;
+	string::size_type start = 0, pos = 0;
+	while ((pos = text.find('$', pos)) != string::npos) {
+		string::size_type end = pos + 1;
+		unsigned int arg = 0;
+		while (end < text.size() && isdigit((unsigned char) text[end])) {
+			arg = arg * 10 + (text[end] - '0');
+			end++;
+		}
+		if (arg == 0) {
+			pos = end;
+			continue;
+		}
+		if (pos > start) {
+			message.segments.push_back({ text.substr(start, pos - start), 0 });
+		}
+		message.segments.push_back({ text.substr(pos, end - pos), arg });
+		start = pos = end;
+	}
+	if (start < text.size()) {
+		message.segments.push_back({ text.substr(start), 0 });
+	}
+
+	message.resolved = true;
+	return message;
+}
+
+string Translator::translate(const string &term,const char *replacestr,...) {
+	const Message &message = resolve(intern(term));
+	if (!replacestr) {
+		return message.text;
 	}
 
+	vector<const char *> args;
 	va_list arglist;
 	va_start(arglist, replacestr);
-	const char *param = replacestr;
-	int argnum = 1;
-	while (param!=NULL) {
-		string id = "";
-		stringstream ss; ss << argnum; ss >> id;
-		result = strreplace(result,"$"+id,param);
-
-		param = va_arg(arglist,const char*);
-		argnum++;
+	for (const char *param = replacestr; param; param = va_arg(arglist, const char*)) {
+		args.push_back(param);
 	}
 	va_end(arglist);
 
+	string result;
+	for (auto& segment : message.segments) {
+		// Placeholders without an argument are kept as they are.
+		if (segment.arg && segment.arg <= args.size()) {
+			result += args[segment.arg - 1];
+		} else {
+			result += segment.text;
+		}
+	}
 	return result;
 }
 
-string Translator::operator[](const string &term) {
-	return translate(term);
+const string &Translator::operator[](const string &term) {
+	return resolve(intern(term)).text;
+}
+
+const string &Translator::operator[](MessageId id) {
+	return resolve(id).text;
 }
 
 string Translator::lang() {
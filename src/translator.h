@@ -21,19 +21,50 @@
 #ifndef TRANSLATOR_H
 #define TRANSLATOR_H
 
+#include <deque>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 /**
 Hash Map of translation strings.
+Terms can be interned, so that code that runs on every frame looks up a
+translation by index instead of hashing the term each time.
 
 	@author Massimiliano Torromeo <massimiliano.torromeo@gmail.com>
 */
 class Translator {
+public:
+	/** Identifies an interned term; it stays valid when the language changes. */
+	enum class MessageId : unsigned int {};
+
 private:
+	/** A piece of a translation: literal text, or an argument. */
+	struct Segment {
+		std::string text;
+		/** The N of a $N placeholder, or 0 for literal text. */
+		unsigned int arg;
+	};
+
+	/** The translation of an interned term in the current language. */
+	struct Message {
+		std::string text;
+		/** The text split at its $N placeholders, to fill them in fast. */
+		std::vector<Segment> segments;
+		bool resolved;
+	};
+
 	std::string _lang;
+	/** Translations read from the language file, by term. */
 	std::unordered_map<std::string, std::string> translations;
 
+	std::unordered_map<std::string, MessageId> termIds;
+	/** Indexed by MessageId; a deque, so references to them stay valid. */
+	std::deque<std::string> terms;
+	std::deque<Message> messages;
+
+	const Message &resolve(MessageId id);
+
 public:
 	Translator(const std::string &lang="");
 	~Translator();
@@ -41,9 +72,14 @@ public:
 	std::string lang();
 	void setLang(const std::string &lang);
 	bool exists(const std::string &term);
+
+	/** Returns the ID of the given term, interning it if needed. */
+	MessageId intern(const std::string &term);
+
 	std::string translate(const std::string &term,
 			const char *replacestr = NULL, ...);
-	std::string operator[](const std::string &term);
+	const std::string &operator[](const std::string &term);
+	const std::string &operator[](MessageId id);
 };
 
 #endif // TRANSLATOR_H
@@ -22,6 +22,7 @@
 #include "utilities.h"
 
 #include "debug.h"
+#include "reactor.h"
 
 #include <SDL.h>
 #include "compat-algorithm.h"
@@ -35,6 +36,8 @@
 #include <iostream>
 #include <sstream>
 #include <cctype>
+#include <cerrno>
+#include <cstring>
 #include <unistd.h>
 
 using namespace std;
@@ -184,6 +187,30 @@ string uniquePath(string const& dir, string const& name)
 	return path;
 }
 
+vector<int> openInputDevices()
+{
+	vector<int> fds;
+	DIR *dirp = opendir("/dev/input");
+	if (!dirp) {
+		return fds;
+	}
+	while (struct dirent *dptr = readdir(dirp)) {
+		if (strncmp(dptr->d_name, "event", 5)) {
+			continue;
+		}
+
+		const string path = string("/dev/input/") + dptr->d_name;
+		int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0) {
+			WARNING("Unable to open '%s': %s\n", path.c_str(), strerror(errno));
+			continue;
+		}
+		fds.push_back(fd);
+	}
+	closedir(dirp);
+	return fds;
+}
+
 //Configuration parsing utilities
 int evalIntConf (ConfIntHash& hash, const std::string &key, int def, int imin, int imax) {
 	auto it = hash.find(key);
@@ -231,12 +258,6 @@ string cmdclean (string cmdline) {
 	return cmdline;
 }
 
-int intTransition(int from, int to, long tickStart, long duration, long tickNow) {
-	if (tickNow<0) tickNow = SDL_GetTicks();
-	return compat::clamp((int)(((tickNow-tickStart) * (to-from)) / duration), from, to);
-	//                    elapsed                 increments
-}
-
 void request_repaint()
 {
 	// if (!PowerSaver::getInstance()->getScreenState())
@@ -248,4 +269,7 @@ void request_repaint()
 	 * event by the InputManager */
 	SDL_PushEvent((SDL_Event *) &e);
 	DEBUG("Injecting event code %i\n", e.code);
+
+	// The main thread may be asleep, waiting for input.
+	Reactor::instance().wakeup();
 }
@@ -86,6 +86,13 @@ bool fileExists(const std::string &file);
  */
 std::string uniquePath(std::string const& dir, std::string const& name);
 
+/**
+ * Opens the event devices in /dev/input, non-blocking and without grabbing
+ * them, so SDL keeps getting their events as well.
+ * @return The file descriptors of the devices that could be opened.
+ */
+std::vector<int> openInputDevices();
+
 int constrain(int x, int imin, int imax);
 
 int evalIntConf(ConfIntHash& hash, const std::string &key, int def, int imin, int imax);
@@ -101,9 +108,6 @@ int evalIntConf(ConfIntHash& hash, const std::string &key, int def, int imin, in
 void split(std::vector<std::string>& vec, std::string const& str,
 		std::string const& delim);
 
-int intTransition(int from, int to, long int tickStart, long duration=500,
-		long tickNow=-1);
-
 void request_repaint();
 
 #endif // UTILITIES_H
@@ -25,6 +25,7 @@
 #include "filelister.h"
 #include "gmenu2x.h"
 #include "iconbutton.h"
+#include "latency.h"
 #include "surface.h"
 #include "utilities.h"
 
@@ -39,6 +40,7 @@ WallpaperDialog::WallpaperDialog(GMenu2X& gmenu2x)
 
 bool WallpaperDialog::exec()
 {
+	InputLatency::Context latency("wallpaper dialog");
 	bool close = false, result = true;
 
 	FileLister fl;
@@ -73,6 +75,10 @@ bool WallpaperDialog::exec()
 	int fontheight = gmenu2x.font->getLineSpacing();
 	unsigned int nb_elements = height / fontheight;
 
+	// Only the selected wallpaper is kept in memory, shrunk to the screen.
+	unique_ptr<OffscreenSurface> preview;
+	uint32_t previewIndex = UINT32_MAX;
+
 	while (!close) {
 		OutputSurface& s = *gmenu2x.s;
 
@@ -82,7 +88,18 @@ bool WallpaperDialog::exec()
 			firstElement = selected;
 
 		//Wallpaper
-		gmenu2x.sc[((string)"skin:wallpapers/" + wallpapers[selected]).c_str()]->blit(s, 0, 0);
+		if (previewIndex != selected && selected < wallpapers.size()) {
+			preview = OffscreenSurface::loadImage(
+					gmenu2x.sc.getSkinFilePath("wallpapers/" + wallpapers[selected]),
+					false, gmenu2x.width(), gmenu2x.height());
+			if (preview) preview->setUse(SurfaceUse::DIALOG);
+			previewIndex = selected;
+		}
+		if (preview) {
+			preview->blit(s, 0, 0);
+		} else {
+			gmenu2x.bg->blit(s, 0, 0);
+		}
 
 		gmenu2x.drawTopBar(s);
 		gmenu2x.drawBottomBar(s);
@@ -112,30 +129,35 @@ bool WallpaperDialog::exec()
 		gmenu2x.drawScrollBar(nb_elements, wallpapers.size(), firstElement);
 		s.flip();
 
-        switch(gmenu2x.input.waitForPressedButton()) {
+        unsigned int steps;
+        switch(gmenu2x.input.waitForPressedButton(&steps)) {
             case InputManager::CANCEL:
                 close = true;
                 result = false;
                 break;
             case InputManager::UP:
-                if (selected == 0) selected = wallpapers.size()-1;
-                else selected -= 1;
+                for (unsigned int n = 0; n < steps; n++) {
+                    if (selected == 0) selected = wallpapers.size()-1;
+                    else selected -= 1;
+                }
                 break;
             case InputManager::ALTLEFT:
-                if ((int)(selected - nb_elements + 1) < 0)
+                if (selected < steps * (nb_elements - 1))
 					selected = 0;
                 else
-					selected -= nb_elements - 1;
+					selected -= steps * (nb_elements - 1);
                 break;
             case InputManager::DOWN:
-                if (selected+1 >= wallpapers.size()) selected = 0;
-                else selected += 1;
+                for (unsigned int n = 0; n < steps; n++) {
+                    if (selected+1 >= wallpapers.size()) selected = 0;
+                    else selected += 1;
+                }
                 break;
             case InputManager::ALTRIGHT:
-                if (selected + nb_elements - 1 >= wallpapers.size())
+                if (selected + steps * (nb_elements - 1) >= wallpapers.size())
 					selected = wallpapers.size() - 1;
                 else
-					selected += nb_elements - 1;
+					selected += steps * (nb_elements - 1);
                 break;
             case InputManager::ACCEPT:
                 close = true;
@@ -147,9 +169,5 @@ bool WallpaperDialog::exec()
         }
 	}
 
-	for (size_t i=0; i<wallpapers.size(); i++) {
-	  gmenu2x.sc.del("skin:wallpapers/" + wallpapers[i]);
-	}
-
 	return result;
 }
@@ -0,0 +1,206 @@
+// Various authors.
+// License: GPL version 2 or later.
+
+// Compares the screens written by an input script with the reference ones,
+// and checks the input latency report against a budget.
+
+#include <png.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Rect {
+	unsigned int x, y, w, h;
+
+	bool contains(unsigned int px, unsigned int py) const {
+		return px >= x && px < x + w && py >= y && py < y + h;
+	}
+};
+
+struct Image {
+	unsigned int width = 0, height = 0;
+	vector<png_byte> pixels;
+};
+
+static bool loadImage(const string &path, Image *image)
+{
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&png, path.c_str())) {
+		fprintf(stderr, "%s: %s\n", path.c_str(), png.message);
+		return false;
+	}
+	png.format = PNG_FORMAT_RGBA;
+	image->width = png.width;
+	image->height = png.height;
+	image->pixels.resize(PNG_IMAGE_SIZE(png));
+	if (!png_image_finish_read(&png, nullptr, image->pixels.data(), 0, nullptr)) {
+		fprintf(stderr, "%s: %s\n", path.c_str(), png.message);
+		png_image_free(&png);
+		return false;
+	}
+	return true;
+}
+
+/** Returns the sorted names of the step screens in a directory. */
+static vector<string> listSteps(const string &dir)
+{
+	vector<string> names;
+	DIR *dirp = opendir(dir.c_str());
+	if (!dirp) {
+		return names;
+	}
+	struct dirent *dptr;
+	while ((dptr = readdir(dirp))) {
+		const size_t len = strlen(dptr->d_name);
+		if (!strncmp(dptr->d_name, "step-", 5) && len > 4
+				&& !strcmp(dptr->d_name + len - 4, ".png")) {
+			names.push_back(dptr->d_name);
+		}
+	}
+	closedir(dirp);
+	sort(names.begin(), names.end());
+	return names;
+}
+
+static bool compareStep(const string &name, const string &refDir,
+		const string &outDir, const vector<Rect> &ignore)
+{
+	Image ref, out;
+	if (!loadImage(refDir + "/" + name, &ref)
+			|| !loadImage(outDir + "/" + name, &out)) {
+		return false;
+	}
+	if (ref.width != out.width || ref.height != out.height) {
+		fprintf(stderr, "%s: size is %ux%u instead of %ux%u\n", name.c_str(),
+				out.width, out.height, ref.width, ref.height);
+		return false;
+	}
+
+	unsigned int count = 0;
+	unsigned int minX = ref.width, minY = ref.height, maxX = 0, maxY = 0;
+	for (unsigned int y = 0; y < ref.height; y++) {
+		for (unsigned int x = 0; x < ref.width; x++) {
+			const size_t offset = (y * ref.width + x) * 4;
+			if (!memcmp(&ref.pixels[offset], &out.pixels[offset], 4)) {
+				continue;
+			}
+			if (any_of(ignore.begin(), ignore.end(),
+					[&](const Rect &r) { return r.contains(x, y); })) {
+				continue;
+			}
+			count++;
+			minX = min(minX, x);
+			minY = min(minY, y);
+			maxX = max(maxX, x);
+			maxY = max(maxY, y);
+		}
+	}
+	if (count) {
+		fprintf(stderr, "%s: %u pixels differ, within %u,%u - %u,%u\n",
+				name.c_str(), count, minX, minY, maxX, maxY);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Checks the worst latency of every screen in the report. Lines hold the
+ * screen name padded to 16 characters, then the count, mean and maximum.
+ */
+static bool checkLatency(const string &path, unsigned int budget)
+{
+	ifstream inf(path);
+	if (!inf.is_open()) {
+		fprintf(stderr, "Unable to open %s\n", path.c_str());
+		return false;
+	}
+
+	bool ok = true;
+	string line;
+	getline(inf, line); // header
+	while (getline(inf, line)) {
+		if (line.size() < 16) {
+			continue;
+		}
+		string name = line.substr(0, 16);
+		name.erase(name.find_last_not_of(' ') + 1);
+		unsigned int count, mean, max;
+		if (sscanf(line.c_str() + 16, "%u %u %u", &count, &mean, &max) != 3) {
+			fprintf(stderr, "%s: malformed line \"%s\"\n",
+					path.c_str(), line.c_str());
+			ok = false;
+			continue;
+		}
+		if (count && max > budget) {
+			fprintf(stderr, "%s: worst latency is %u ms, budget is %u ms\n",
+					name.c_str(), max, budget);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [--ignore X,Y,W,H]... [--max-latency MS] "
+			"REFERENCE_DIR OUTPUT_DIR\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	vector<Rect> ignore;
+	unsigned int maxLatency = 0;
+	int i = 1;
+	for (; i < argc && !strncmp(argv[i], "--", 2); i++) {
+		if (!strcmp(argv[i], "--ignore") && i + 1 < argc) {
+			Rect r;
+			if (sscanf(argv[++i], "%u,%u,%u,%u", &r.x, &r.y, &r.w, &r.h) != 4) {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			ignore.push_back(r);
+		} else if (!strcmp(argv[i], "--max-latency") && i + 1 < argc) {
+			maxLatency = strtoul(argv[++i], nullptr, 10);
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - i != 2) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	const string refDir = argv[i], outDir = argv[i + 1];
+
+	const vector<string> refSteps = listSteps(refDir);
+	const vector<string> outSteps = listSteps(outDir);
+	bool ok = true;
+	if (refSteps != outSteps) {
+		fprintf(stderr, "Got %zu steps, expected %zu\n",
+				outSteps.size(), refSteps.size());
+		ok = false;
+	}
+	for (const string &name : refSteps) {
+		if (find(outSteps.begin(), outSteps.end(), name) != outSteps.end()) {
+			ok &= compareStep(name, refDir, outDir, ignore);
+		}
+	}
+	if (maxLatency) {
+		ok &= checkLatency(outDir + "/latency.txt", maxLatency);
+	}
+
+	if (ok) {
+		printf("%zu steps match\n", refSteps.size());
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
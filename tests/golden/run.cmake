@@ -0,0 +1,60 @@
+# Runs one golden-image test case; see CMakeLists.txt for the arguments.
+# With UPDATE set, the screens are copied to references/ instead of being
+# compared with them.
+
+set(home ${WORK}/home)
+set(frames ${WORK}/frames)
+set(references ${SOURCE}/references/${CASE})
+set(FIXTURES ${SOURCE}/fixtures)
+
+# Every run starts from the same configuration.
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${home}/.gmenu2x/sections/applications ${frames})
+configure_file(${FIXTURES}/gmenu2x.conf.in ${home}/.gmenu2x/gmenu2x.conf @ONLY)
+configure_file(${FIXTURES}/files.link.in
+	${home}/.gmenu2x/sections/applications/files @ONLY)
+
+execute_process(
+	COMMAND ${CMAKE_COMMAND} -E env
+		HOME=${home}
+		GMENU2X_HEADLESS=${frames}
+		GMENU2X_FRAME_FORMAT=none
+		GMENU2X_INPUT_SCRIPT=${SOURCE}/cases/${CASE}.txt
+		${GMENU2X}
+	RESULT_VARIABLE result
+	TIMEOUT 60)
+if (NOT result EQUAL 0)
+	message(FATAL_ERROR "gmenu2x failed on ${CASE}: ${result}")
+endif ()
+
+file(GLOB steps ${frames}/step-*.png)
+if (NOT steps)
+	message(FATAL_ERROR "gmenu2x wrote no screens for ${CASE}")
+endif ()
+
+if (UPDATE)
+	file(REMOVE_RECURSE ${references})
+	file(COPY ${steps} DESTINATION ${references})
+	list(LENGTH steps count)
+	message(STATUS "Wrote ${count} reference frames for ${CASE}")
+	return()
+endif ()
+
+if (NOT EXISTS ${references})
+	message(FATAL_ERROR
+		"No reference frames for ${CASE}; build the golden-update target")
+endif ()
+
+set(ignoreArgs)
+string(REPLACE "+" ";" rects "${IGNORE}")
+foreach (rect ${rects})
+	list(APPEND ignoreArgs --ignore ${rect})
+endforeach ()
+
+execute_process(
+	COMMAND ${COMPARE} ${ignoreArgs} --max-latency ${MAX_LATENCY}
+		${references} ${frames}
+	RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+	message(FATAL_ERROR "${CASE} does not match ${references} or the latency budget")
+endif ()